@@ -0,0 +1,45 @@
+#!/bin/bash
+
+# measures how the analysis scales
+# for each line of configurations.txt: a synthetic application is generated
+# and compiled to (optimized) IR, then the analysis is run on it with opt
+# reports wall time (s) and peak memory (KB) of the analysis
+#
+# usage: benchmark.sh [path to libmpi_assertion_checker.so] [configurations]
+# using mpich: MPICC needs to be set, like for run.sh
+
+BENCHMARK_DIR=$(dirname $(readlink -f $0))
+PLUGIN=$(readlink -f ${1:-build/mpi_assertion_checker/libmpi_assertion_checker.so})
+CONFIGURATIONS=${2:-$BENCHMARK_DIR/configurations.txt}
+OPT=${OPT:-opt}
+
+WORK_DIR=$(mktemp -d)
+trap "rm -rf $WORK_DIR" EXIT
+
+printf "%-16s %10s %12s %s\n" "name" "time (s)" "memory (KB)" "result"
+
+while read -u 6 name args; do
+  # skip empty lines and comments
+  if [ -z "$name" ] || [ "${name:0:1}" == "#" ]; then
+    continue
+  fi
+
+  python3 $BENCHMARK_DIR/generate_benchmark.py $args -o $WORK_DIR/$name.c
+  $MPICC -cc=clang -O2 -S -emit-llvm $WORK_DIR/$name.c -o $WORK_DIR/$name.ll
+  if [ $? -ne 0 ]; then
+    printf "%-16s %10s %12s %s\n" "$name" "-" "-" "COMPILATION FAILED"
+    continue
+  fi
+
+  read time memory < <(python3 $BENCHMARK_DIR/measure.py $WORK_DIR/$name.out \
+    $OPT -load-pass-plugin $PLUGIN -passes=mpi-assertion-checker \
+    -disable-output $WORK_DIR/$name.ll)
+  if grep -q "Successfully executed the pass" $WORK_DIR/$name.out; then
+    result="ok"
+  else
+    result="CRASHED"
+  fi
+  printf "%-16s %10s %12s %s\n" "$name" "$time" "$memory" "$result"
+
+done 6<$CONFIGURATIONS
+# not use stdin rather use input channel 6
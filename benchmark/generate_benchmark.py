@@ -0,0 +1,152 @@
+#!/usr/bin/env python3
+"""
+  Copyright 2020 Tim Jammer
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+       http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.
+
+Generates a synthetic MPI application (C source) to measure how the
+assertion checker scales.
+The MPI calls are placed in a kernel function, that is reached through a
+chain of helper functions and contains a loop nest.
+Each MPI call site is placed in its own guarded block, so that the number of
+calls, blocks, loops, call chain depth and Isend/Wait scopes can be varied
+independently.
+"""
+
+import argparse
+import sys
+
+
+def generate(calls, blocks, loop_depth, call_depth, nonblocking, out):
+    w = out.write
+
+    w("#include <mpi.h>\n")
+    w("#include <stdlib.h>\n\n")
+    w("#define N 1000\n\n")
+    w("// generated by generate_benchmark.py --calls %d --blocks %d "
+      "--loop-depth %d --call-depth %d --nonblocking %d\n\n" %
+      (calls, blocks, loop_depth, call_depth, nonblocking))
+
+    # the kernel
+    w("__attribute__((noinline)) void kernel(int *data, int rank, int size) {\n")
+    w("  int next = (rank + 1) % size;\n")
+    w("  int pre = (rank + size - 1) % size;\n")
+    if nonblocking > 0:
+        w("  MPI_Request req[%d];\n" % nonblocking)
+    w("  int sum = 0;\n")
+    w("  int global_sum = 0;\n")
+
+    indent = "  "
+    for depth in range(loop_depth):
+        w("%sfor (int i%d = 0; i%d < N; ++i%d) {\n" %
+          (indent, depth, depth, depth))
+        indent += "  "
+    index = " + ".join(["i%d" % d for d in range(loop_depth)]) or "0"
+    w("%sint idx = (%s) %% N;\n" % (indent, index))
+
+    # the Isends are completed at the end of the innermost loop body
+    for r in range(nonblocking):
+        w("%sMPI_Isend(&data[%d], 1, MPI_INT, next, %d, MPI_COMM_WORLD, "
+          "&req[%d]);\n" % (indent, r % 1000, 1000 + r, r))
+
+    # the blocks without MPI calls are distributed between the call sites
+    num_sites = max(calls, 1)
+    for c in range(calls):
+        for b in range(blocks // num_sites + (1 if c < blocks % num_sites else 0)):
+            w("%sif (data[(idx + %d) %% N] > %d) {\n" % (indent, b, c + b))
+            w("%s  sum += data[(idx + %d) %% N];\n" % (indent, c))
+            w("%s}\n" % indent)
+        # alternate between send and receive
+        # different tags, so that there is no conflict in the application
+        w("%sif (data[idx] %% %d == %d) {\n" % (indent, calls + 1, c))
+        if c % 2 == 0:
+            w("%s  MPI_Send(&data[idx], 1, MPI_INT, next, %d, MPI_COMM_WORLD);\n"
+              % (indent, c))
+        else:
+            w("%s  MPI_Recv(&data[idx], 1, MPI_INT, pre, %d, MPI_COMM_WORLD,\n"
+              "%s           MPI_STATUS_IGNORE);\n" % (indent, c, indent))
+        w("%s}\n" % indent)
+    if calls == 0:
+        for b in range(blocks):
+            w("%sif (data[(idx + %d) %% N] > %d) {\n" % (indent, b, b))
+            w("%s  sum += data[idx];\n" % indent)
+            w("%s}\n" % indent)
+
+    for r in range(nonblocking):
+        w("%sMPI_Wait(&req[%d], MPI_STATUS_IGNORE);\n" % (indent, r))
+
+    for depth in reversed(range(loop_depth)):
+        indent = indent[:-2]
+        if depth == 0:
+            # each iteration of the outer loop is fenced by an allreduce
+            w("%s  MPI_Allreduce(&sum, &global_sum, 1, MPI_INT, MPI_SUM, "
+              "MPI_COMM_WORLD);\n" % indent)
+        w("%s}\n" % indent)
+    w("  data[0] = global_sum;\n")
+    w("}\n\n")
+
+    # chain of helper functions leading to the kernel
+    callee = "kernel"
+    for layer in reversed(range(call_depth)):
+        name = "layer_%d" % layer
+        w("__attribute__((noinline)) void %s(int *data, int rank, int size) {\n"
+          % name)
+        w("  %s(data, rank, size);\n" % callee)
+        w("}\n\n")
+        callee = name
+
+    w("int main(int argc, char **argv) {\n")
+    w("  int *data = malloc(N * sizeof(int));\n")
+    w("  for (int i = 0; i < N; ++i) {\n")
+    w("    data[i] = i;\n")
+    w("  }\n\n")
+    w("  MPI_Init(&argc, &argv);\n")
+    w("  int rank, size;\n")
+    w("  MPI_Comm_rank(MPI_COMM_WORLD, &rank);\n")
+    w("  MPI_Comm_size(MPI_COMM_WORLD, &size);\n\n")
+    w("  %s(data, rank, size);\n\n" % callee)
+    w("  MPI_Finalize();\n")
+    w("  free(data);\n")
+    w("  return 0;\n")
+    w("}\n")
+
+
+def main():
+    parser = argparse.ArgumentParser(
+        description="Generates a synthetic MPI application for benchmarking "
+        "the assertion checker")
+    parser.add_argument("--calls", type=int, default=10,
+                        help="number of MPI send/recv call sites")
+    parser.add_argument("--blocks", type=int, default=0,
+                        help="number of additional basic blocks without MPI")
+    parser.add_argument("--loop-depth", type=int, default=1,
+                        help="depth of the loop nest around the calls")
+    parser.add_argument("--call-depth", type=int, default=0,
+                        help="number of functions between main and the calls")
+    parser.add_argument("--nonblocking", type=int, default=0,
+                        help="number of Isend/Wait scopes")
+    parser.add_argument("-o", "--output", default="-",
+                        help="output file (default: stdout)")
+    args = parser.parse_args()
+
+    if args.output == "-":
+        generate(args.calls, args.blocks, args.loop_depth, args.call_depth,
+                 args.nonblocking, sys.stdout)
+    else:
+        with open(args.output, "w") as out:
+            generate(args.calls, args.blocks, args.loop_depth, args.call_depth,
+                     args.nonblocking, out)
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,39 @@
+#!/usr/bin/env python3
+"""
+  Copyright 2020 Tim Jammer
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+       http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.
+
+Runs a command and prints its wall time (s) and peak memory (KB).
+The output of the command is written to the given file.
+usage: measure.py output_file command [args...]
+"""
+
+import resource
+import subprocess
+import sys
+import time
+
+
+def main():
+    with open(sys.argv[1], "w") as out:
+        start = time.time()
+        subprocess.call(sys.argv[2:], stdout=out, stderr=subprocess.STDOUT)
+        wall_time = time.time() - start
+    # only one child process was started
+    peak_memory = resource.getrusage(resource.RUSAGE_CHILDREN).ru_maxrss
+    print("%.2f %d" % (wall_time, peak_memory))
+
+
+if __name__ == "__main__":
+    main()
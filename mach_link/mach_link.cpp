@@ -0,0 +1,129 @@
+/*
+  Copyright 2020 Tim Jammer
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+       http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.
+ */
+
+// mach-link: combines the communication summaries of all modules of a
+// program (written with -mach-summary-dir) and reports the verdict for the
+// whole program
+// usage: mach-link <summary files or directories>
+
+#include "llvm/ADT/StringRef.h"
+#include "llvm/Support/CommandLine.h"
+#include "llvm/Support/FileSystem.h"
+#include "llvm/Support/InitLLVM.h"
+#include "llvm/Support/MemoryBuffer.h"
+#include "llvm/Support/Path.h"
+#include "llvm/Support/WithColor.h"
+#include "llvm/Support/raw_ostream.h"
+
+#include <algorithm>
+#include <string>
+#include <vector>
+
+#include "summary_file.h"
+#include "summary_link.h"
+
+using namespace llvm;
+
+static cl::list<std::string>
+    InputPaths(cl::Positional, cl::OneOrMore,
+               cl::desc("<summary files or directories containing them>"));
+
+// the summaries of the given directories are sorted by name, so that the
+// result does not depend on the order of the directory entries
+static bool collect_summary_files(StringRef path,
+                                  std::vector<std::string> &files) {
+  if (!sys::fs::is_directory(path)) {
+    files.push_back(path.str());
+    return true;
+  }
+
+  std::vector<std::string> found;
+  std::error_code EC;
+  for (sys::fs::directory_iterator it(path, EC), end; it != end && !EC;
+       it.increment(EC)) {
+    if (StringRef(it->path()).endswith(summary_file_extension)) {
+      found.push_back(it->path());
+    }
+  }
+  if (EC) {
+    WithColor::error() << path << ": " << EC.message() << "\n";
+    return false;
+  }
+  std::sort(found.begin(), found.end());
+  files.insert(files.end(), found.begin(), found.end());
+  return true;
+}
+
+int main(int argc, char **argv) {
+  InitLLVM X(argc, argv);
+  cl::ParseCommandLineOptions(
+      argc, argv, "combines the communication summaries of a program\n");
+
+  std::vector<std::string> files;
+  for (const auto &path : InputPaths) {
+    if (!collect_summary_files(path, files)) {
+      return 1;
+    }
+  }
+  if (files.empty()) {
+    WithColor::error() << "no summaries found\n";
+    return 1;
+  }
+
+  SummaryLinker linker;
+  for (const auto &file : files) {
+    auto buffer = MemoryBuffer::getFile(file);
+    if (!buffer) {
+      WithColor::error() << file << ": " << buffer.getError().message()
+                         << "\n";
+      return 1;
+    }
+    auto summary = read_summary((*buffer)->getBuffer());
+    if (!summary) {
+      WithColor::error() << file << ": " << toString(summary.takeError())
+                         << "\n";
+      return 1;
+    }
+    linker.add(std::move(*summary));
+  }
+
+  const auto result = linker.link();
+
+  for (const auto &conflict : result.conflicts) {
+    outs() << conflict << "\n";
+  }
+  if (!result.conflicts.empty()) {
+    outs() << "Message race conflicts detected\n";
+  } else {
+    outs() << "No conflicts detected, try to use mpi_assert_allow_overtaking "
+              "for better performance\n";
+  }
+  if (result.no_any_tag) {
+    outs() << "You can also safely specify mpi_assert_no_any_tag for better "
+              "performance\n";
+  }
+  if (result.no_any_source) {
+    outs() << "You can also safely specify mpi_assert_no_any_source for "
+              "better performance\n";
+  }
+  if (result.exact_length) {
+    outs() << "You can also safely specify mpi_assert_exact_length for "
+              "better performance\n";
+  }
+  outs() << "Combined the summaries of " << files.size() << " modules\n";
+
+  return 0;
+}
@@ -0,0 +1,309 @@
+/*
+  Copyright 2020 Tim Jammer
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+       http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.
+ */
+
+#include "summary_link.h"
+
+#include <algorithm>
+
+using namespace llvm;
+
+// more envelopes per function are treated as any envelope
+static const unsigned max_envelopes = 16;
+
+bool SummaryLinker::Envelope::operator==(const Envelope &other) const {
+  return comm == other.comm && peer == other.peer && tag == other.tag;
+}
+
+bool SummaryLinker::Envelope::may_match(const Envelope &other) const {
+  auto differ = [](const std::string &a, const std::string &b) {
+    return !a.empty() && !b.empty() && a != b;
+  };
+  return !differ(comm, other.comm) && !differ(peer, other.peer) &&
+         !differ(tag, other.tag);
+}
+
+bool SummaryLinker::EnvelopeSet::insert(const Envelope &envelope) {
+  if (any ||
+      std::find(envelopes.begin(), envelopes.end(), envelope) !=
+          envelopes.end()) {
+    return false;
+  }
+  if (envelopes.size() == max_envelopes) {
+    any = true;
+    envelopes.clear();
+  } else {
+    envelopes.push_back(envelope);
+  }
+  return true;
+}
+
+bool SummaryLinker::EnvelopeSet::insert_all(const EnvelopeSet &other) {
+  if (any) {
+    return false;
+  }
+  if (other.any) {
+    any = true;
+    envelopes.clear();
+    return true;
+  }
+  bool changed = false;
+  for (const auto &envelope : other.envelopes) {
+    changed |= insert(envelope);
+  }
+  return changed;
+}
+
+bool SummaryLinker::EnvelopeSet::may_match(const Envelope &envelope) const {
+  return any || std::any_of(envelopes.begin(), envelopes.end(),
+                            [&](const Envelope &other) {
+                              return other.may_match(envelope);
+                            });
+}
+
+SummaryLinker::Envelope
+SummaryLinker::get_envelope(const MessageSummary &message) {
+  // arguments and unknown values may be anything
+  auto get_constant = [](const std::string &value) {
+    StringRef str(value);
+    return str.startswith("const:") || str.startswith("global:")
+               ? value
+               : std::string();
+  };
+  Envelope result;
+  result.comm = get_constant(message.comm);
+  result.peer = get_constant(message.peer);
+  result.tag = get_constant(message.tag);
+  return result;
+}
+
+std::string SummaryLinker::describe(const ModuleSummary &module,
+                                    const FunctionSummary &function,
+                                    const MessageSummary &message) {
+  return message.mpi_function + " (" + (message.is_send ? "send" : "recv") +
+         " comm=" + message.comm + " peer=" + message.peer +
+         " tag=" + message.tag + ") in " + function.name + " of " +
+         module.module_name;
+}
+
+void SummaryLinker::ReturnOrdering::add_call(
+    const ExternalCallSummary &call) {
+  if (!is_called) {
+    is_called = true;
+    is_synced = call.is_synced;
+    synced_comms = call.synced_comms;
+    return;
+  }
+  if (call.is_synced) {
+    return;
+  }
+  if (is_synced) {
+    is_synced = false;
+    synced_comms = call.synced_comms;
+    return;
+  }
+  // the communicators synced for all calls
+  synced_comms.erase(
+      std::remove_if(synced_comms.begin(), synced_comms.end(),
+                     [&](const std::string &comm) {
+                       return std::find(call.synced_comms.begin(),
+                                        call.synced_comms.end(),
+                                        comm) == call.synced_comms.end();
+                     }),
+      synced_comms.end());
+}
+
+bool SummaryLinker::ReturnOrdering::is_ordered(
+    const MessageSummary &message, bool is_program_complete) const {
+  if (!is_called) {
+    // otherwise it may be called from a module without a summary
+    return is_program_complete;
+  }
+  return is_synced ||
+         std::find(synced_comms.begin(), synced_comms.end(), message.comm) !=
+             synced_comms.end();
+}
+
+void SummaryLinker::add(ModuleSummary summary) {
+  modules.push_back(std::move(summary));
+}
+
+unsigned SummaryLinker::resolve(unsigned module, StringRef name) const {
+  auto local = local_functions[module].find(name);
+  if (local != local_functions[module].end()) {
+    return local->second;
+  }
+  return exported_functions.lookup(name);
+}
+
+void SummaryLinker::build_call_graph() {
+  nodes.resize(1);
+  nodes[0].sends.set_any();
+  nodes[0].recvs.set_any();
+  local_functions.resize(modules.size());
+
+  for (unsigned int m = 0; m < modules.size(); ++m) {
+    for (const auto &function : modules[m].functions) {
+      if (!function.is_local && function.name == "main") {
+        is_program_complete = true;
+      }
+      Node node;
+      node.module = m;
+      node.function = &function;
+      nodes.push_back(std::move(node));
+      // inline functions may be defined in several modules, the first
+      // definition is used
+      if (function.is_local) {
+        local_functions[m].insert(std::make_pair(function.name,
+                                                 nodes.size() - 1));
+      } else {
+        exported_functions.insert(std::make_pair(function.name,
+                                                 nodes.size() - 1));
+      }
+    }
+  }
+
+  for (unsigned int n = 1; n < nodes.size(); ++n) {
+    const unsigned m = nodes[n].module;
+    const auto &function = *nodes[n].function;
+    for (const auto &name : function.callees) {
+      nodes[resolve(m, name)].callers.push_back(n);
+    }
+    for (const auto &name : function.unknown_callees) {
+      unsigned callee = resolve(m, name);
+      nodes[callee].callers.push_back(n);
+      has_unresolved_callees |= callee == 0;
+    }
+    for (const auto &call : function.external_calls) {
+      unsigned callee = resolve(m, call.callee);
+      if (callee != 0 && nodes[callee].module != m) {
+        nodes[callee].return_ordering.add_call(call);
+      }
+    }
+  }
+}
+
+void SummaryLinker::propagate_envelopes() {
+  std::vector<unsigned> worklist;
+  std::vector<bool> in_worklist(nodes.size(), true);
+  for (unsigned int n = 0; n < nodes.size(); ++n) {
+    worklist.push_back(n);
+    if (n == 0) {
+      continue;
+    }
+    for (const auto &message : nodes[n].function->messages) {
+      auto &envelopes = message.is_send ? nodes[n].sends : nodes[n].recvs;
+      envelopes.insert(get_envelope(message));
+    }
+  }
+
+  // the callers include the envelopes of the callees
+  // each set only changes a bounded number of times, so each node is only
+  // visited a bounded number of times
+  while (!worklist.empty()) {
+    unsigned n = worklist.back();
+    worklist.pop_back();
+    in_worklist[n] = false;
+    for (unsigned caller : nodes[n].callers) {
+      bool changed = nodes[caller].sends.insert_all(nodes[n].sends);
+      changed |= nodes[caller].recvs.insert_all(nodes[n].recvs);
+      if (changed && !in_worklist[caller]) {
+        worklist.push_back(caller);
+        in_worklist[caller] = true;
+      }
+    }
+  }
+}
+
+void SummaryLinker::check_message(unsigned module,
+                                  const FunctionSummary &function,
+                                  const MessageSummary &message,
+                                  LinkResult &result) const {
+  const auto &module_summary = modules[module];
+
+  if (message.has_local_conflict) {
+    result.conflicts.push_back(describe(module_summary, function, message) +
+                               " conflicts with another call of the module");
+  }
+
+  const auto envelope = get_envelope(message);
+  for (const auto &name : message.pending_calls) {
+    unsigned callee = resolve(module, name);
+    const auto &envelopes =
+        message.is_send ? nodes[callee].sends : nodes[callee].recvs;
+    if (callee == 0) {
+      result.conflicts.push_back(describe(module_summary, function, message) +
+                                 " may be pending when calling " + name +
+                                 ", which has no summary");
+      // it may use any tag, source or length as well
+      result.no_any_tag = false;
+      result.no_any_source = false;
+      result.exact_length = false;
+    } else if (envelopes.may_match(envelope)) {
+      result.conflicts.push_back(describe(module_summary, function, message) +
+                                 " may be pending when calling " + name +
+                                 ", which may " +
+                                 (message.is_send ? "send" : "receive") +
+                                 " a matching message");
+    }
+  }
+
+  for (const auto &name : message.pending_at_return) {
+    if (!nodes[resolve(module, name)].return_ordering.is_ordered(
+            message, is_program_complete)) {
+      result.conflicts.push_back(describe(module_summary, function, message) +
+                                 " may be pending when " + name +
+                                 " returns into another module");
+    }
+  }
+}
+
+LinkResult SummaryLinker::link() {
+  LinkResult result;
+  if (modules.empty()) {
+    result.conflicts.push_back("no summaries were given");
+    result.no_any_tag = false;
+    result.no_any_source = false;
+    result.exact_length = false;
+    return result;
+  }
+
+  build_call_graph();
+  propagate_envelopes();
+
+  for (unsigned int n = 1; n < nodes.size(); ++n) {
+    for (const auto &message : nodes[n].function->messages) {
+      check_message(nodes[n].module, *nodes[n].function, message, result);
+    }
+  }
+
+  for (const auto &module : modules) {
+    if (!module.is_checked) {
+      result.conflicts.push_back("the conflicts of " + module.module_name +
+                                 " were not checked");
+    }
+    result.no_any_tag = result.no_any_tag && module.no_any_tag;
+    result.no_any_source = result.no_any_source && module.no_any_source;
+    result.exact_length = result.exact_length && module.exact_length;
+  }
+  // functions without a summary may use any tag, source or length
+  if (has_unresolved_callees) {
+    result.no_any_tag = false;
+    result.no_any_source = false;
+    result.exact_length = false;
+  }
+
+  return result;
+}
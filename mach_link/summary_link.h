@@ -0,0 +1,137 @@
+/*
+  Copyright 2020 Tim Jammer
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+       http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.
+ */
+
+#ifndef MACH_SUMMARY_LINK_H_
+#define MACH_SUMMARY_LINK_H_
+
+#include "llvm/ADT/StringMap.h"
+#include "llvm/ADT/StringRef.h"
+
+#include "communication_summary.h"
+
+#include <string>
+#include <vector>
+
+// the verdict for the whole program
+struct LinkResult {
+  // why messages may conflict (empty if there are no conflicts)
+  std::vector<std::string> conflicts;
+  bool no_any_tag = true;
+  bool no_any_source = true;
+  bool exact_length = true;
+};
+
+// combines the communication summaries of all modules of a program
+// calls of functions of other modules are resolved by name, then the
+// conflicts found within each module are checked again:
+// - conflicts between MPI calls of the same module remain
+// - calling a function of another module while a message may be pending only
+//   conflicts, if the function (or anything it calls) sends or receives a
+//   message with a matching envelope
+// - a message that may still be pending when a function returns into another
+//   module conflicts, unless all calls of the function from other modules are
+//   followed by a sync point on its communicator before anything communicates
+//   a function without such calls is only known not to be called at all, if
+//   the program is complete (one of the summaries defines main)
+// functions without a summary (e.g. of a library compiled without the pass)
+// may communicate anything, using any tag, source or length
+// all steps are linear in the size of the summaries
+class SummaryLinker {
+public:
+  void add(ModuleSummary summary);
+
+  LinkResult link();
+
+private:
+  // the constant parts of a message envelope (empty if it may be anything)
+  struct Envelope {
+    std::string comm;
+    std::string peer;
+    std::string tag;
+
+    bool operator==(const Envelope &other) const;
+    bool may_match(const Envelope &other) const;
+  };
+
+  // the envelopes of the messages a function (including its callees) sends
+  // or receives
+  // only a few envelopes are kept, more are treated as any envelope, so that
+  // each set only changes a bounded number of times
+  class EnvelopeSet {
+  public:
+    // returns if the set has changed
+    bool insert(const Envelope &envelope);
+    bool insert_all(const EnvelopeSet &other);
+    void set_any() { any = true; }
+    bool may_match(const Envelope &envelope) const;
+
+  private:
+    bool any = false;
+    std::vector<Envelope> envelopes;
+  };
+
+  // how the calls from other modules order the messages still pending when a
+  // function returns
+  struct ReturnOrdering {
+    bool is_called = false;
+    // each call is followed by a sync point, regardless of the communicator
+    bool is_synced = true;
+    // otherwise: the communicators, for which each call is followed by a sync
+    // point
+    std::vector<std::string> synced_comms;
+
+    void add_call(const ExternalCallSummary &call);
+    // is_program_complete: there are no calls from modules without a summary
+    bool is_ordered(const MessageSummary &message,
+                    bool is_program_complete) const;
+  };
+
+  struct Node {
+    unsigned module = 0;
+    const FunctionSummary *function = nullptr;
+    std::vector<unsigned> callers;
+    EnvelopeSet sends;
+    EnvelopeSet recvs;
+    ReturnOrdering return_ordering;
+  };
+
+  static Envelope get_envelope(const MessageSummary &message);
+  static std::string describe(const ModuleSummary &module,
+                              const FunctionSummary &function,
+                              const MessageSummary &message);
+
+  void build_call_graph();
+  void propagate_envelopes();
+  // the node of the function called by name from within a module (the
+  // unknown node if there is no summary for it)
+  unsigned resolve(unsigned module, llvm::StringRef name) const;
+  void check_message(unsigned module, const FunctionSummary &function,
+                     const MessageSummary &message, LinkResult &result) const;
+
+  std::vector<ModuleSummary> modules;
+
+  // node 0 is the unknown function
+  std::vector<Node> nodes;
+  llvm::StringMap<unsigned> exported_functions;
+  // per module: the functions with local linkage
+  std::vector<llvm::StringMap<unsigned>> local_functions;
+  // one of the modules defines main
+  bool is_program_complete = false;
+  // a function that may communicate is called, but has no summary
+  bool has_unresolved_callees = false;
+};
+
+#endif /* MACH_SUMMARY_LINK_H_ */
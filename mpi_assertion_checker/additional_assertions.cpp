@@ -15,18 +15,19 @@
  */
 
 #include "additional_assertions.h"
+#include "analysis_context.h"
 #include "conflict_detection.h"
-#include "implementation_specific.h"
 #include "mpi_functions.h"
 
 #include "llvm/IR/InstrTypes.h"
+#include "llvm/Support/TimeProfiler.h"
 #include "llvm/Support/raw_ostream.h"
 
 using namespace llvm;
 
 // Todo may use some refactoring to avoid code duplication here
 // Todo may do analysis on a per communicator basis
-bool check_any_tag_for_function(Function *f) {
+bool check_any_tag_for_function(const AnalysisContext &ctx, Function *f) {
   if (f == nullptr) {
     return true;
   } else {
@@ -34,9 +35,9 @@ bool check_any_tag_for_function(Function *f) {
 
       if (auto *call = dyn_cast<CallBase>(u)) {
         if (call->getCalledFunction() == f) {
-          auto *tag = get_tag(call, false);
+          auto *tag = get_tag(*ctx.mpi_func, call, false);
           if (auto *c = dyn_cast<Constant>(tag)) {
-            if (c == mpi_implementation_specifics->ANY_TAG) {
+            if (c == ctx.mpi_implementation_specifics->ANY_TAG) {
               return false;
             }
           }
@@ -50,7 +51,7 @@ bool check_any_tag_for_function(Function *f) {
   return true;
 }
 
-bool check_any_source_for_function(Function *f) {
+bool check_any_source_for_function(const AnalysisContext &ctx, Function *f) {
   if (f == nullptr) {
     return true;
   } else {
@@ -58,9 +59,9 @@ bool check_any_source_for_function(Function *f) {
 
       if (auto *call = dyn_cast<CallBase>(u)) {
         if (call->getCalledFunction() == f) {
-          auto *src = get_src(call, false);
+          auto *src = get_src(*ctx.mpi_func, call, false);
           if (auto *c = dyn_cast<Constant>(src)) {
-            if (c == mpi_implementation_specifics->ANY_SOURCE) {
+            if (c == ctx.mpi_implementation_specifics->ANY_SOURCE) {
               return false;
             }
           }
@@ -73,103 +74,43 @@ bool check_any_source_for_function(Function *f) {
 }
 
 // checks wether the mpi_assert_no_any_tag flag may be set
-bool check_no_any_tag(llvm::Module &M) {
+bool check_no_any_tag(const AnalysisContext &ctx, llvm::Module &M) {
+  TimeTraceScope trace_scope("MPICheckNoAnyTag", M.getName());
   bool result = true;
-  result = result && check_any_tag_for_function(mpi_func->mpi_recv);
-  result = result && check_any_tag_for_function(mpi_func->mpi_Irecv);
+  result = result && check_any_tag_for_function(ctx, ctx.mpi_func->mpi_recv);
+  result = result && check_any_tag_for_function(ctx, ctx.mpi_func->mpi_Irecv);
   // TODO add mpi probe, iprobe, mprobe, improbe,
 
   return result;
 }
 
 // checks wether the mpi_assert_no_any_source flag may be set
-bool check_no_any_source(llvm::Module &M) {
+bool check_no_any_source(const AnalysisContext &ctx, llvm::Module &M) {
+  TimeTraceScope trace_scope("MPICheckNoAnySource", M.getName());
   bool result = true;
-  result = result && check_any_source_for_function(mpi_func->mpi_recv);
-  result = result && check_any_source_for_function(mpi_func->mpi_Irecv);
+  result =
+      result && check_any_source_for_function(ctx, ctx.mpi_func->mpi_recv);
+  result =
+      result && check_any_source_for_function(ctx, ctx.mpi_func->mpi_Irecv);
   // TODO add mpi probe, iprobe, mprobe, improbe,
 
   return result;
 }
 
-Value *get_type(CallBase *mpi_call, bool is_send) {
-
-  unsigned int total_num_args = 0;
-  unsigned int type_arg_pos = 0;
-
-  if (mpi_call->getCalledFunction() == mpi_func->mpi_send ||
-      mpi_call->getCalledFunction() == mpi_func->mpi_Bsend ||
-      mpi_call->getCalledFunction() == mpi_func->mpi_Ssend ||
-      mpi_call->getCalledFunction() == mpi_func->mpi_Rsend) {
-    assert(is_send);
-    total_num_args = 6;
-    type_arg_pos = 2;
-  } else if (mpi_call->getCalledFunction() == mpi_func->mpi_Isend) {
-    assert(is_send);
-    total_num_args = 7;
-    type_arg_pos = 2;
-  } else if (mpi_call->getCalledFunction() == mpi_func->mpi_recv ||
-             mpi_call->getCalledFunction() == mpi_func->mpi_Irecv) {
-    assert(!is_send);
-    total_num_args = 7;
-    type_arg_pos = 2;
-  } else if (mpi_call->getCalledFunction() == mpi_func->mpi_Sendrecv) {
-    total_num_args = 12;
-    if (is_send)
-      type_arg_pos = 2;
-    else
-      type_arg_pos = 7;
-  } else {
-    errs() << mpi_call->getCalledFunction()->getName()
-           << ": This MPI function is currently not supported\n";
-    assert(false);
-  }
-
-  assert(mpi_call->getNumArgOperands() == total_num_args);
-
-  return mpi_call->getArgOperand(type_arg_pos);
+Value *get_type(const struct mpi_functions &mpi_func, CallBase *mpi_call,
+                bool is_send) {
+  return get_mpi_argument(mpi_func, mpi_call, MPIArgument::Type, is_send);
 }
 
-Value *get_count(CallBase *mpi_call, bool is_send) {
-
-  unsigned int total_num_args = 0;
-  unsigned int count_arg_pos = 0;
-
-  if (mpi_call->getCalledFunction() == mpi_func->mpi_send ||
-      mpi_call->getCalledFunction() == mpi_func->mpi_Bsend ||
-      mpi_call->getCalledFunction() == mpi_func->mpi_Ssend ||
-      mpi_call->getCalledFunction() == mpi_func->mpi_Rsend) {
-    assert(is_send);
-    total_num_args = 6;
-    count_arg_pos = 1;
-  } else if (mpi_call->getCalledFunction() == mpi_func->mpi_Isend) {
-    assert(is_send);
-    total_num_args = 7;
-    count_arg_pos = 1;
-  } else if (mpi_call->getCalledFunction() == mpi_func->mpi_recv ||
-             mpi_call->getCalledFunction() == mpi_func->mpi_Irecv) {
-    assert(!is_send);
-    total_num_args = 7;
-    count_arg_pos = 1;
-  } else if (mpi_call->getCalledFunction() == mpi_func->mpi_Sendrecv) {
-    total_num_args = 12;
-    if (is_send)
-      count_arg_pos = 1;
-    else
-      count_arg_pos = 6;
-  } else {
-    errs() << mpi_call->getCalledFunction()->getName()
-           << ": This MPI function is currently not supported\n";
-    assert(false);
-  }
-
-  assert(mpi_call->getNumArgOperands() == total_num_args);
-
-  return mpi_call->getArgOperand(count_arg_pos);
+Value *get_count(const struct mpi_functions &mpi_func, CallBase *mpi_call,
+                 bool is_send) {
+  return get_mpi_argument(mpi_func, mpi_call, MPIArgument::Count, is_send);
 }
 
 std::vector<std::tuple<Value *, Value *, int>>
-get_lengths_for_function(Function *F, bool is_send) {
+get_lengths_for_function(const AnalysisContext &ctx, Function *F,
+                         bool is_send) {
+  const auto &mpi_func = *ctx.mpi_func;
 
   if (F == nullptr) {
     return {};
@@ -179,11 +120,14 @@ get_lengths_for_function(Function *F, bool is_send) {
   for (auto *u : F->users()) {
     if (auto *call = dyn_cast<CallBase>(u)) {
       if (call->getCalledFunction() == F) {
-        if (auto *type = dyn_cast<Constant>(get_type(call, is_send))) {
+        if (auto *type =
+                dyn_cast<Constant>(get_type(mpi_func, call, is_send))) {
 
-          int size = mpi_implementation_specifics->get_size_of_mpi_type(type);
-          result.push_back(std::make_tuple(get_tag(call, is_send),
-                                           get_count(call, is_send), size));
+          int size =
+              ctx.mpi_implementation_specifics->get_size_of_mpi_type(type);
+          result.push_back(std::make_tuple(get_tag(mpi_func, call, is_send),
+                                           get_count(mpi_func, call, is_send),
+                                           size));
 
         } else {
           errs() << "Using a user defined type: could not detect "
@@ -242,37 +186,38 @@ bool check_lengths_for_conflicts(
 }
 
 // TODO also have a look at mpi_assert_exact_length
-bool check_exact_length(llvm::Module &M) {
+bool check_exact_length(const AnalysisContext &ctx, llvm::Module &M) {
+  TimeTraceScope trace_scope("MPICheckExactLength", M.getName());
 
   // list of Tag, count,type_size for all sends/recvs
   std::vector<std::tuple<Value *, Value *, int>> sizes;
   // maps each tag to a msg size
 
-  auto tmp = get_lengths_for_function(mpi_func->mpi_send, true);
+  auto tmp = get_lengths_for_function(ctx, ctx.mpi_func->mpi_send, true);
   sizes.insert(sizes.end(), tmp.begin(), tmp.end());
-  tmp = get_lengths_for_function(mpi_func->mpi_Isend, true);
+  tmp = get_lengths_for_function(ctx, ctx.mpi_func->mpi_Isend, true);
   sizes.insert(sizes.end(), tmp.begin(), tmp.end());
-  tmp = get_lengths_for_function(mpi_func->mpi_Bsend, true);
+  tmp = get_lengths_for_function(ctx, ctx.mpi_func->mpi_Bsend, true);
   sizes.insert(sizes.end(), tmp.begin(), tmp.end());
-  tmp = get_lengths_for_function(mpi_func->mpi_Rsend, true);
+  tmp = get_lengths_for_function(ctx, ctx.mpi_func->mpi_Rsend, true);
   sizes.insert(sizes.end(), tmp.begin(), tmp.end());
-  tmp = get_lengths_for_function(mpi_func->mpi_Ssend, true);
+  tmp = get_lengths_for_function(ctx, ctx.mpi_func->mpi_Ssend, true);
   sizes.insert(sizes.end(), tmp.begin(), tmp.end());
-  tmp = get_lengths_for_function(mpi_func->mpi_Ibsend, true);
+  tmp = get_lengths_for_function(ctx, ctx.mpi_func->mpi_Ibsend, true);
   sizes.insert(sizes.end(), tmp.begin(), tmp.end());
-  tmp = get_lengths_for_function(mpi_func->mpi_Irsend, true);
+  tmp = get_lengths_for_function(ctx, ctx.mpi_func->mpi_Irsend, true);
   sizes.insert(sizes.end(), tmp.begin(), tmp.end());
-  tmp = get_lengths_for_function(mpi_func->mpi_Issend, true);
+  tmp = get_lengths_for_function(ctx, ctx.mpi_func->mpi_Issend, true);
   sizes.insert(sizes.end(), tmp.begin(), tmp.end());
-  tmp = get_lengths_for_function(mpi_func->mpi_Sendrecv, true);
+  tmp = get_lengths_for_function(ctx, ctx.mpi_func->mpi_Sendrecv, true);
   sizes.insert(sizes.end(), tmp.begin(), tmp.end());
 
   // recv
-  tmp = get_lengths_for_function(mpi_func->mpi_recv, false);
+  tmp = get_lengths_for_function(ctx, ctx.mpi_func->mpi_recv, false);
   sizes.insert(sizes.end(), tmp.begin(), tmp.end());
-  tmp = get_lengths_for_function(mpi_func->mpi_Irecv, false);
+  tmp = get_lengths_for_function(ctx, ctx.mpi_func->mpi_Irecv, false);
   sizes.insert(sizes.end(), tmp.begin(), tmp.end());
-  tmp = get_lengths_for_function(mpi_func->mpi_Sendrecv, false);
+  tmp = get_lengths_for_function(ctx, ctx.mpi_func->mpi_Sendrecv, false);
   sizes.insert(sizes.end(), tmp.begin(), tmp.end());
 
   return check_lengths_for_conflicts(M, sizes);
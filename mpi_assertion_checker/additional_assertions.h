@@ -19,9 +19,12 @@
 
 #include "llvm/IR/Module.h"
 
-bool check_no_any_tag(llvm::Module &M);
-bool check_no_any_source(llvm::Module &M);
+#include "analysis_context.h"
 
-bool check_exact_length(llvm::Module &M);
+// mpi_func and mpi_implementation_specifics of ctx need to be set up
+bool check_no_any_tag(const AnalysisContext &ctx, llvm::Module &M);
+bool check_no_any_source(const AnalysisContext &ctx, llvm::Module &M);
+
+bool check_exact_length(const AnalysisContext &ctx, llvm::Module &M);
 
 #endif /* MACH_ADDITIONAL_ASSERTIONS_H_ */
@@ -0,0 +1,413 @@
+/*
+ Copyright 2020 Tim Jammer
+
+ Licensed under the Apache License, Version 2.0 (the "License");
+ you may not use this file except in compliance with the License.
+ You may obtain a copy of the License at
+
+ http://www.apache.org/licenses/LICENSE-2.0
+
+ Unless required by applicable law or agreed to in writing, software
+ distributed under the License is distributed on an "AS IS" BASIS,
+ WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ See the License for the specific language governing permissions and
+ limitations under the License.
+ */
+
+#include "analysis_cache.h"
+#include "binary_stream.h"
+
+#include "llvm/ADT/EquivalenceClasses.h"
+#include "llvm/ADT/SmallString.h"
+#include "llvm/ADT/Statistic.h"
+#include "llvm/ADT/StringExtras.h"
+#include "llvm/Config/llvm-config.h"
+#include "llvm/IR/InstIterator.h"
+#include "llvm/IR/ModuleSlotTracker.h"
+#include "llvm/Support/FileSystem.h"
+#include "llvm/Support/MemoryBuffer.h"
+#include "llvm/Support/Path.h"
+#include "llvm/Support/raw_ostream.h"
+#include "llvm/Support/xxhash.h"
+
+#include <algorithm>
+
+using namespace llvm;
+
+#define DEBUG_TYPE "mpi-assertion-checker"
+
+STATISTIC(NumCachedFunctions,
+          "Functions whose results were taken from the analysis cache");
+STATISTIC(NumWrittenFunctions, "Functions written to the analysis cache");
+
+// "MACC" followed by the version of the format
+// the version is part of the hash as well, so that entries of an older version
+// are not even read
+static const char cache_magic[] = {'M', 'A', 'C', 'C'};
+static const uint64_t cache_version = 1;
+
+static const char *cache_file_extension = ".machcache";
+
+// the attributes are only printed as a reference to their attribute group
+static void print_attributes(raw_ostream &os, AttributeList attributes,
+                             unsigned num_args) {
+  os << attributes.getAsString(AttributeList::FunctionIndex) << "|"
+     << attributes.getAsString(AttributeList::ReturnIndex);
+  for (unsigned i = 0; i < num_args; ++i) {
+    os << "|" << attributes.getAsString(AttributeList::FirstArgIndex + i);
+  }
+  os << "\n";
+}
+
+// Function::print would number the globals of the module again for every
+// function, so it is printed as a Value with a slot tracker for the module
+static void print_global(raw_ostream &os, const GlobalValue &GV,
+                         ModuleSlotTracker &MST) {
+  static_cast<const Value &>(GV).print(os, MST);
+  os << "\n";
+  if (auto *F = dyn_cast<Function>(&GV)) {
+    print_attributes(os, F->getAttributes(), F->arg_size());
+  }
+}
+
+// the parts of the module every function may depend on
+static uint64_t get_environment_hash(Module &M, ModuleSlotTracker &MST,
+                                     uint64_t profile_hash) {
+  std::string text;
+  raw_string_ostream os(text);
+  os << cache_version << " " << LLVM_VERSION_STRING << " " << profile_hash
+     << "\n";
+  os << M.getTargetTriple() << "\n" << M.getDataLayoutStr() << "\n";
+  for (auto *type : M.getIdentifiedStructTypes()) {
+    type->print(os);
+    os << "\n";
+  }
+  for (auto &G : M.globals()) {
+    print_global(os, G, MST);
+  }
+  for (auto &A : M.aliases()) {
+    print_global(os, A, MST);
+  }
+  for (auto &F : M) {
+    if (F.isDeclaration()) {
+      print_global(os, F, MST);
+    }
+  }
+  return xxHash64(os.str());
+}
+
+static uint64_t get_function_hash(Function &F, ModuleSlotTracker &MST) {
+  std::string text;
+  raw_string_ostream os(text);
+  print_global(os, F, MST);
+  for (auto &I : instructions(F)) {
+    if (auto *call = dyn_cast<CallBase>(&I)) {
+      print_attributes(os, call->getAttributes(), call->arg_size());
+    }
+  }
+  return xxHash64(os.str());
+}
+
+// the defined functions grouped by the components of the call graph
+// nullptr stands for any function that may be called indirectly
+static std::vector<std::vector<Function *>> get_components(Module &M) {
+  EquivalenceClasses<Function *> classes;
+  for (auto &F : M) {
+    if (F.isDeclaration()) {
+      continue;
+    }
+    classes.insert(&F);
+    for (auto *user : F.users()) {
+      auto *call = dyn_cast<CallBase>(user);
+      if (call != nullptr && call->getCalledFunction() == &F) {
+        classes.unionSets(&F, call->getFunction());
+      } else {
+        // the address is taken
+        classes.unionSets(&F, nullptr);
+      }
+    }
+    for (auto &I : instructions(F)) {
+      auto *call = dyn_cast<CallBase>(&I);
+      if (call != nullptr && call->getCalledFunction() == nullptr &&
+          !call->isInlineAsm()) {
+        classes.unionSets(&F, nullptr);
+      }
+    }
+  }
+
+  std::vector<std::vector<Function *>> result;
+  for (auto it = classes.begin(); it != classes.end(); ++it) {
+    if (!it->isLeader()) {
+      continue;
+    }
+    std::vector<Function *> functions;
+    for (auto member = classes.member_begin(it); member != classes.member_end();
+         ++member) {
+      if (*member != nullptr) {
+        functions.push_back(*member);
+      }
+    }
+    if (!functions.empty()) {
+      result.push_back(std::move(functions));
+    }
+  }
+  return result;
+}
+
+AnalysisCache::AnalysisCache(StringRef dir, Module &M, uint64_t profile_hash)
+    : dir(dir.str()) {
+  ModuleSlotTracker MST(&M);
+  const uint64_t environment_hash =
+      get_environment_hash(M, MST, profile_hash);
+
+  for (auto &functions : get_components(M)) {
+    Component component;
+    component.functions = std::move(functions);
+    std::sort(component.functions.begin(), component.functions.end(),
+              [](Function *a, Function *b) {
+                return a->getName() < b->getName();
+              });
+
+    std::string text;
+    raw_string_ostream os(text);
+    os << environment_hash;
+    for (auto *F : component.functions) {
+      component.is_cacheable &= F->hasName();
+      os << "\n" << F->getName() << " " << get_function_hash(*F, MST);
+    }
+    component.key = xxHash64(os.str());
+
+    for (auto *F : component.functions) {
+      component_of[F] = components.size();
+    }
+    if (component.is_cacheable && load(component)) {
+      component.is_cached = true;
+      NumCachedFunctions += component.functions.size();
+    }
+    components.push_back(std::move(component));
+  }
+}
+
+std::string AnalysisCache::get_entry_path(const Component &component) const {
+  SmallString<128> path(dir);
+  sys::path::append(path, utohexstr(component.key) + cache_file_extension);
+  return path.str().str();
+}
+
+// a missing or unreadable entry is not an error, the component is analyzed
+// again instead
+bool AnalysisCache::load(Component &component) {
+  auto buffer = MemoryBuffer::getFile(get_entry_path(component));
+  if (!buffer) {
+    return false;
+  }
+  StringRef data = (*buffer)->getBuffer();
+  if (!data.startswith(StringRef(cache_magic, sizeof(cache_magic)))) {
+    return false;
+  }
+  BinaryReader reader(data.drop_front(sizeof(cache_magic)));
+  if (reader.read_number() != cache_version) {
+    return false;
+  }
+
+  const auto &functions = component.functions;
+  if (reader.read_size() != functions.size()) {
+    return false;
+  }
+
+  // the calls are identified by the index of the function within the
+  // component and their index within the function
+  std::vector<std::vector<Instruction *>> instructions_of(functions.size());
+  auto get_call = [&](uint64_t function, uint64_t index) -> CallBase * {
+    if (function >= functions.size()) {
+      return nullptr;
+    }
+    auto &instructions = instructions_of[function];
+    if (instructions.empty()) {
+      for (auto &I : llvm::instructions(*functions[function])) {
+        instructions.push_back(&I);
+      }
+    }
+    if (index >= instructions.size()) {
+      return nullptr;
+    }
+    return dyn_cast<CallBase>(instructions[index]);
+  };
+
+  // only taken over if the whole entry is valid
+  DenseMap<Function *, FunctionProperties> loaded_properties;
+  std::map<CallPart, std::vector<CallBase *>> loaded_conflicts;
+  bool is_valid = true;
+  for (unsigned int i = 0; i < functions.size(); ++i) {
+    is_valid &= reader.read_string() == functions[i]->getName();
+    FunctionProperties info;
+    info.flags = reader.read_number();
+    loaded_properties[functions[i]] = info;
+
+    const size_t num_calls = reader.read_size();
+    for (size_t c = 0; c < num_calls; ++c) {
+      auto *call = get_call(i, reader.read_number());
+      const bool is_send = reader.read_number();
+      std::vector<CallBase *> partners(reader.read_size());
+      for (auto &partner : partners) {
+        const uint64_t function = reader.read_number();
+        partner = get_call(function, reader.read_number());
+        is_valid &= partner != nullptr;
+      }
+      is_valid &= call != nullptr;
+      loaded_conflicts[std::make_pair(call, is_send)] = std::move(partners);
+    }
+  }
+  if (!is_valid || reader.has_failed() || !reader.at_end()) {
+    return false;
+  }
+
+  for (auto &entry : loaded_properties) {
+    properties.insert(entry);
+  }
+  conflicts.insert(loaded_conflicts.begin(), loaded_conflicts.end());
+  return true;
+}
+
+bool AnalysisCache::lookup_properties(Function *F,
+                                      FunctionProperties &properties) const {
+  auto search = this->properties.find(F);
+  if (search == this->properties.end()) {
+    return false;
+  }
+  properties = search->second;
+  return true;
+}
+
+const std::vector<CallBase *> *
+AnalysisCache::lookup_conflicts(CallBase *call, bool is_send) const {
+  static const std::vector<CallBase *> no_conflicts;
+
+  auto component = component_of.find(call->getFunction());
+  if (component == component_of.end() ||
+      !components[component->second].is_cached) {
+    return nullptr;
+  }
+  auto search = conflicts.find(std::make_pair(call, is_send));
+  if (search == conflicts.end()) {
+    return &no_conflicts;
+  }
+  return &search->second;
+}
+
+bool AnalysisCache::is_complete() const {
+  return std::all_of(
+      components.begin(), components.end(),
+      [](const Component &component) { return component.is_cached; });
+}
+
+void AnalysisCache::insert_conflicts(CallBase *call, bool is_send,
+                                     std::vector<CallBase *> conflicts) {
+  if (!conflicts.empty()) {
+    this->conflicts[std::make_pair(call, is_send)] = std::move(conflicts);
+  }
+}
+
+// written to a temporary file first, as other compilations may read the
+// entry at the same time
+static Error write_entry(StringRef path, StringRef data) {
+  int fd;
+  SmallString<128> temp_path;
+  if (auto EC = sys::fs::createUniqueFile(path + "-%%%%%%.tmp", fd,
+                                          temp_path)) {
+    return errorCodeToError(EC);
+  }
+
+  raw_fd_ostream os(fd, /*shouldClose=*/true);
+  os << data;
+  os.close();
+  if (os.has_error()) {
+    auto EC = os.error();
+    os.clear_error();
+    sys::fs::remove(temp_path);
+    return errorCodeToError(EC);
+  }
+
+  if (auto EC = sys::fs::rename(temp_path, path)) {
+    sys::fs::remove(temp_path);
+    return errorCodeToError(EC);
+  }
+  return Error::success();
+}
+
+Error AnalysisCache::write(const FunctionMetadata &function_metadata) const {
+  if (auto EC = sys::fs::create_directories(dir)) {
+    return errorCodeToError(EC);
+  }
+
+  for (const auto &component : components) {
+    if (component.is_cached || !component.is_cacheable) {
+      continue;
+    }
+    const auto &functions = component.functions;
+
+    DenseMap<Function *, unsigned> function_index;
+    DenseMap<Instruction *, uint64_t> instruction_index;
+    for (unsigned int i = 0; i < functions.size(); ++i) {
+      function_index[functions[i]] = i;
+      uint64_t index = 0;
+      for (auto &I : instructions(*functions[i])) {
+        instruction_index[&I] = index++;
+      }
+    }
+
+    // the partners are part of the same component, unless the pending
+    // messages follow calls that are not part of the call graph
+    bool is_complete = true;
+    std::string data;
+    raw_string_ostream os(data);
+    os.write(cache_magic, sizeof(cache_magic));
+    BinaryWriter writer(os);
+    writer.write_number(cache_version);
+    writer.write_number(functions.size());
+    for (auto *F : functions) {
+      writer.write_string(F->getName());
+      writer.write_number(function_metadata.get_properties(F).flags);
+
+      std::vector<std::pair<CallPart, const std::vector<CallBase *> *>>
+          calls_with_conflicts;
+      for (auto &I : instructions(*F)) {
+        if (auto *call = dyn_cast<CallBase>(&I)) {
+          for (bool is_send : {true, false}) {
+            auto search = conflicts.find(std::make_pair(call, is_send));
+            if (search != conflicts.end()) {
+              calls_with_conflicts.push_back(
+                  std::make_pair(search->first, &search->second));
+            }
+          }
+        }
+      }
+
+      writer.write_number(calls_with_conflicts.size());
+      for (const auto &entry : calls_with_conflicts) {
+        writer.write_number(instruction_index[entry.first.first]);
+        writer.write_number(entry.first.second);
+        writer.write_number(entry.second->size());
+        for (auto *partner : *entry.second) {
+          auto search = function_index.find(partner->getFunction());
+          if (search == function_index.end()) {
+            is_complete = false;
+            break;
+          }
+          writer.write_number(search->second);
+          writer.write_number(instruction_index[partner]);
+        }
+      }
+    }
+    os.flush();
+    if (!is_complete) {
+      continue;
+    }
+
+    if (auto error = write_entry(get_entry_path(component), data)) {
+      return error;
+    }
+    NumWrittenFunctions += functions.size();
+  }
+  return Error::success();
+}
@@ -0,0 +1,99 @@
+/*
+  Copyright 2020 Tim Jammer
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+       http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.
+ */
+
+#ifndef MACH_ANALYSIS_CACHE_H_
+#define MACH_ANALYSIS_CACHE_H_
+
+#include "llvm/ADT/DenseMap.h"
+#include "llvm/ADT/StringRef.h"
+#include "llvm/IR/InstrTypes.h"
+#include "llvm/IR/Module.h"
+#include "llvm/Support/Error.h"
+
+#include "function_coverage.h"
+
+#include <map>
+#include <string>
+#include <utility>
+#include <vector>
+
+// results of the conflict detection kept on disk across builds
+// (-mach-cache-dir)
+// the functions are grouped into the components of the call graph, as the
+// results of a function depend on the functions it calls and (for the pending
+// messages) on its callers; functions whose address is taken and functions
+// with indirect calls form one component
+// each component is stored in its own file, named after the hash of the IR of
+// its functions, the declarations and globals of the module and the MPI
+// implementation, so that a changed function only invalidates its own
+// component
+// an entry holds the FunctionMetadata flags of each function and the conflicts
+// reported from each MPI call
+class AnalysisCache {
+public:
+  // loads the entries of all components of M that are present in dir
+  // profile_hash identifies the MPI implementation
+  AnalysisCache(llvm::StringRef dir, llvm::Module &M, uint64_t profile_hash);
+  ~AnalysisCache(){};
+
+  // false if the function is not cached
+  bool lookup_properties(llvm::Function *F,
+                         FunctionProperties &properties) const;
+
+  // the calls reported as conflicting with the given part of call (is_send
+  // selects the part of a Sendrecv)
+  // nullptr if the function of the call is not cached
+  const std::vector<llvm::CallBase *> *lookup_conflicts(llvm::CallBase *call,
+                                                        bool is_send) const;
+
+  // whether every component is cached, so that the conflict detection does
+  // not need to traverse the module at all
+  bool is_complete() const;
+
+  // the conflicts reported from a call that is not cached
+  void insert_conflicts(llvm::CallBase *call, bool is_send,
+                        std::vector<llvm::CallBase *> conflicts);
+
+  // writes the components that were not cached
+  // the conflicts of all their calls need to be inserted beforehand
+  llvm::Error write(const FunctionMetadata &function_metadata) const;
+
+private:
+  struct Component {
+    // sorted by name
+    std::vector<llvm::Function *> functions;
+    uint64_t key = 0;
+    // unnamed functions cannot be identified in the next build
+    bool is_cacheable = true;
+    bool is_cached = false;
+  };
+
+  using CallPart = std::pair<llvm::CallBase *, bool>;
+
+  std::string get_entry_path(const Component &component) const;
+  bool load(Component &component);
+
+  std::string dir;
+  std::vector<Component> components;
+  llvm::DenseMap<llvm::Function *, unsigned> component_of;
+  // only the cached functions
+  llvm::DenseMap<llvm::Function *, FunctionProperties> properties;
+  // loaded for the cached components, inserted for the others
+  // calls without conflicts are not stored
+  std::map<CallPart, std::vector<llvm::CallBase *>> conflicts;
+};
+
+#endif /* MACH_ANALYSIS_CACHE_H_ */
@@ -0,0 +1,58 @@
+/*
+  Copyright 2020 Tim Jammer
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+       http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.
+ */
+
+#ifndef MACH_ANALYSIS_CONTEXT_H_
+#define MACH_ANALYSIS_CONTEXT_H_
+
+#include "analysis_cache.h"
+#include "analysis_results.h"
+#include "block_numbering.h"
+#include "conflict_cache.h"
+#include "function_coverage.h"
+#include "implementation_specific.h"
+#include "loop_ordering.h"
+#include "mpi_functions.h"
+#include "pending_messages.h"
+#include "request_completions.h"
+
+#include <memory>
+
+// the state of the analysis of one module
+// one context is created for each run of the pass and passed to the detection
+// and assertion functions, so that several modules may be analyzed
+// concurrently within one process (e.g. by the ThinLTO backends)
+// the parts are only set up if the selected analysis needs them
+struct AnalysisContext {
+  std::unique_ptr<mpi_functions> mpi_func;
+  std::unique_ptr<RequiredAnalysisResults> analysis_results;
+  // the combined summary index when running in a ThinLTO backend (nullptr
+  // otherwise), functions of other modules are classified with it
+  const llvm::ModuleSummaryIndex *combined_index = nullptr;
+
+  std::unique_ptr<ImplementationSpecifics> mpi_implementation_specifics;
+  std::unique_ptr<FunctionMetadata> function_metadata;
+
+  // only needed for the conflict detection
+  std::unique_ptr<BlockNumbering> block_numbering;
+  std::unique_ptr<RequestCompletions> request_completions;
+  std::unique_ptr<PendingMessages> pending_messages;
+  std::unique_ptr<ConflictCache> conflict_cache;
+  std::unique_ptr<LoopOrdering> loop_ordering;
+  // only with -mach-cache-dir
+  std::unique_ptr<AnalysisCache> analysis_cache;
+};
+
+#endif /* MACH_ANALYSIS_CONTEXT_H_ */
@@ -14,62 +14,84 @@
  limitations under the License.
  */
 
-#include "mpi_functions.h"
-
+#include "llvm/ADT/Statistic.h"
+#include "llvm/IR/Module.h"
 #include "llvm/Pass.h"
+#include "llvm/Support/raw_ostream.h"
 
 #include "analysis_results.h"
+#include "debug.h"
 
 using namespace llvm;
 
-RequiredAnalysisResults::RequiredAnalysisResults(Pass *parent_pass) {
+#define DEBUG_TYPE "mpi-assertion-checker"
+
+STATISTIC(NumAnalysisCacheHits,
+          "Function analyses (LoopInfo, SCEV) reused from the cache");
+STATISTIC(NumAnalysisCacheMisses,
+          "Function analyses (LoopInfo, SCEV) computed");
+
+FunctionAnalyses::FunctionAnalyses(Function &F, const TargetLibraryInfo &TLI)
+    : TLI(TLI), DT(F), AC(F), LI(DT), SE(F, this->TLI, AC, DT, LI) {}
+
+RequiredAnalysisResults::RequiredAnalysisResults(Pass *parent_pass,
+                                                 Module &M) {
 
   assertion_checker_pass = parent_pass;
 
-  assert(mpi_func != nullptr &&
-         "The search for MPI functions should be made first");
+  assert(!M.empty() && "Module uses MPI, so it has at least one function");
 
   // yust give it any function, the Function is not used at all
   // dont know why the api has changed here...
   TLI = &assertion_checker_pass->getAnalysis<TargetLibraryInfoWrapperPass>()
-             .getTLI(*mpi_func->mpi_init);
-
-  current_LI_function = nullptr;
-  current_SE_function = nullptr;
-  current_AA_function = nullptr;
-  current_LI = nullptr;
-  current_SE = nullptr;
-  current_AA = nullptr;
+             .getTLI(*M.begin());
+}
+
+RequiredAnalysisResults::~RequiredAnalysisResults() {
+  // with the new pass manager, the analyses are cached by the FAM
+  Debug(if (FAM == nullptr) {
+    errs() << "Function analyses: " << NumAnalysisCacheMisses << " computed, "
+           << NumAnalysisCacheHits << " reused\n";
+  });
+}
+
+RequiredAnalysisResults::RequiredAnalysisResults(
+    llvm::FunctionAnalysisManager &FAM, Module &M) {
+
+  this->FAM = &FAM;
+
+  assert(!M.empty() && "Module uses MPI, so it has at least one function");
+
+  TLI = &FAM.getResult<TargetLibraryAnalysis>(*M.begin());
 }
 
-llvm::AAResults *RequiredAnalysisResults::getAAResults(llvm::Function *f) {
-  if (current_AA_function != f) {
-    current_AA_function = f;
-    current_AA = &assertion_checker_pass->getAnalysis<AAResultsWrapperPass>(*f)
-                      .getAAResults();
+FunctionAnalyses &RequiredAnalysisResults::get_analyses(llvm::Function *f) {
+  assert(assertion_checker_pass != nullptr);
+  auto &entry = analyses[f];
+  if (entry) {
+    ++NumAnalysisCacheHits;
+  } else {
+    ++NumAnalysisCacheMisses;
+    entry = std::make_unique<FunctionAnalyses>(
+        *f, assertion_checker_pass->getAnalysis<TargetLibraryInfoWrapperPass>()
+                .getTLI(*f));
   }
 
-  return current_AA;
+  return *entry;
 }
 
 llvm::LoopInfo *RequiredAnalysisResults::getLoopInfo(llvm::Function *f) {
-  if (current_LI_function != f) {
-    current_LI_function = f;
-    current_LI = &assertion_checker_pass->getAnalysis<LoopInfoWrapperPass>(*f)
-                      .getLoopInfo();
+  if (FAM) {
+    return &FAM->getResult<LoopAnalysis>(*f);
   }
-
-  return current_LI;
+  return &get_analyses(f).LI;
 }
+
 llvm::ScalarEvolution *RequiredAnalysisResults::getSE(llvm::Function *f) {
-  if (current_SE_function != f) {
-    current_SE_function = f;
-    current_SE =
-        &assertion_checker_pass->getAnalysis<ScalarEvolutionWrapperPass>(*f)
-             .getSE();
+  if (FAM) {
+    return &FAM->getResult<ScalarEvolutionAnalysis>(*f);
   }
-
-  return current_SE;
+  return &get_analyses(f).SE;
 }
 
 llvm::TargetLibraryInfo *RequiredAnalysisResults::getTLI() { return TLI; }
@@ -17,43 +17,57 @@
 #ifndef MACH_ANALYSIS_RESULTS_H
 #define MACH_ANALYSIS_RESULTS_H
 
-#include "llvm/Analysis/AliasAnalysis.h"
+#include "llvm/ADT/DenseMap.h"
+#include "llvm/Analysis/AssumptionCache.h"
 #include "llvm/Analysis/LoopInfo.h"
 #include "llvm/Analysis/ScalarEvolution.h"
+#include "llvm/Analysis/TargetLibraryInfo.h"
+#include "llvm/IR/Dominators.h"
 #include "llvm/IR/Function.h"
+#include "llvm/IR/PassManager.h"
 #include "llvm/Pass.h"
 
+#include <memory>
+
+// the analyses of one function
+// they are computed once and kept until the end of the pass, as the legacy
+// pass manager would recompute them every time the function changes
+struct FunctionAnalyses {
+  FunctionAnalyses(llvm::Function &F, const llvm::TargetLibraryInfo &TLI);
+
+  // own copy, the one of the TargetLibraryInfoWrapperPass will be overwritten
+  // for the next function
+  llvm::TargetLibraryInfo TLI;
+  llvm::DominatorTree DT;
+  llvm::AssumptionCache AC;
+  llvm::LoopInfo LI;
+  llvm::ScalarEvolution SE;
+};
+
+// with the new pass manager, the analyses are taken from (and cached by) the
+// FunctionAnalysisManager instead
 class RequiredAnalysisResults {
 public:
-  RequiredAnalysisResults(llvm::Pass *parent_pass);
-  ~RequiredAnalysisResults(){};
-  llvm::AAResults *getAAResults(llvm::Function *f);
+  // the TLI is taken for any function of M
+  RequiredAnalysisResults(llvm::Pass *parent_pass, llvm::Module &M);
+  RequiredAnalysisResults(llvm::FunctionAnalysisManager &FAM, llvm::Module &M);
+  ~RequiredAnalysisResults();
   llvm::LoopInfo *getLoopInfo(llvm::Function *f);
   llvm::ScalarEvolution *getSE(llvm::Function *f);
 
   llvm::TargetLibraryInfo *getTLI();
 
 private:
-  llvm::Function *current_AA_function;
-  llvm::AAResults *current_AA;
-  llvm::Function *current_LI_function;
-  llvm::LoopInfo *current_LI;
-  llvm::Function *current_SE_function;
-  llvm::ScalarEvolution *current_SE;
+  FunctionAnalyses &get_analyses(llvm::Function *f);
+
+  llvm::DenseMap<llvm::Function *, std::unique_ptr<FunctionAnalyses>>
+      analyses;
 
   llvm::TargetLibraryInfo *TLI;
-  // reference to the pass
-  llvm::Pass *assertion_checker_pass;
+  // reference to the pass (legacy pass manager)
+  llvm::Pass *assertion_checker_pass = nullptr;
+  // new pass manager
+  llvm::FunctionAnalysisManager *FAM = nullptr;
 };
 
-// will be managed by main
-
-// result of Alias analysis
-// extern std::map<llvm::Function *, llvm::AliasAnalysis *> AA;
-// result of Loop Analysis
-// extern std::map<llvm::Function *, llvm::LoopInfo *> LI;
-// extern std::map<llvm::Function *, llvm::ScalarEvolution *> SE;
-
-extern RequiredAnalysisResults *analysis_results;
-
 #endif
@@ -0,0 +1,116 @@
+/*
+  Copyright 2020 Tim Jammer
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+       http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.
+ */
+
+#ifndef MACH_BINARY_STREAM_H_
+#define MACH_BINARY_STREAM_H_
+
+#include "llvm/ADT/StringRef.h"
+#include "llvm/Support/LEB128.h"
+#include "llvm/Support/raw_ostream.h"
+
+#include <string>
+#include <vector>
+
+// the encoding of the binary files written by the pass (communication
+// summaries and the analysis cache)
+// all numbers are ULEB128 encoded, strings are prefixed with their length,
+// lists with their number of elements
+// reading does not fail at the first error, instead has_failed() needs to be
+// checked at the end
+
+class BinaryWriter {
+public:
+  BinaryWriter(llvm::raw_ostream &os) : os(os){};
+
+  void write_number(uint64_t value) { llvm::encodeULEB128(value, os); }
+
+  void write_string(llvm::StringRef str) {
+    write_number(str.size());
+    os << str;
+  }
+
+  void write_strings(const std::vector<std::string> &strings) {
+    write_number(strings.size());
+    for (const auto &str : strings) {
+      write_string(str);
+    }
+  }
+
+private:
+  llvm::raw_ostream &os;
+};
+
+class BinaryReader {
+public:
+  BinaryReader(llvm::StringRef buffer) : buffer(buffer){};
+
+  uint64_t read_number() {
+    if (failed) {
+      return 0;
+    }
+    unsigned length = 0;
+    const char *error = nullptr;
+    uint64_t value = llvm::decodeULEB128(buffer.bytes_begin() + pos, &length,
+                                         buffer.bytes_end(), &error);
+    if (error != nullptr) {
+      failed = true;
+      return 0;
+    }
+    pos += length;
+    return value;
+  }
+
+  std::string read_string() {
+    uint64_t size = read_number();
+    if (failed || size > buffer.size() - pos) {
+      failed = true;
+      return "";
+    }
+    std::string result = buffer.substr(pos, size).str();
+    pos += size;
+    return result;
+  }
+
+  std::vector<std::string> read_strings() {
+    std::vector<std::string> result(read_size());
+    for (auto &str : result) {
+      str = read_string();
+    }
+    return result;
+  }
+
+  // number of elements of a list
+  // each element needs at least one byte, so that a corrupted size does not
+  // lead to a huge allocation
+  size_t read_size() {
+    uint64_t size = read_number();
+    if (failed || size > buffer.size() - pos) {
+      failed = true;
+      return 0;
+    }
+    return size;
+  }
+
+  bool has_failed() const { return failed; }
+  bool at_end() const { return pos == buffer.size(); }
+
+private:
+  llvm::StringRef buffer;
+  size_t pos = 0;
+  bool failed = false;
+};
+
+#endif /* MACH_BINARY_STREAM_H_ */
@@ -0,0 +1,68 @@
+/*
+  Copyright 2020 Tim Jammer
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+       http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.
+ */
+
+#include "block_numbering.h"
+
+#include "llvm/IR/InstrTypes.h"
+
+using namespace llvm;
+
+BlockNumbering::BlockNumbering(llvm::Module &M) {
+
+  for (auto &F : M) {
+    auto &function_entries = entries[&F];
+
+    for (auto &BB : F) {
+      indices.insert(
+          std::make_pair(BB.getFirstNonPHI(), function_entries.size()));
+      function_entries.push_back(BB.getFirstNonPHI());
+    }
+
+    // return sites
+    for (auto &BB : F) {
+      for (auto &I : BB) {
+        if (auto *call = dyn_cast<CallBase>(&I)) {
+          auto *callee = call->getCalledFunction();
+          auto *next = call->getNextNode();
+          if (callee != nullptr && !callee->isDeclaration() &&
+              next != nullptr) {
+            indices.insert(std::make_pair(next, function_entries.size()));
+            function_entries.push_back(next);
+          }
+        }
+      }
+    }
+  }
+}
+
+unsigned BlockNumbering::get_num_entries(llvm::Function *F) const {
+  auto search = entries.find(F);
+  assert(search != entries.end());
+  return search->second.size();
+}
+
+unsigned BlockNumbering::get_index(llvm::Instruction *entry) const {
+  auto search = indices.find(entry);
+  assert(search != indices.end() && "Not an entry point of the traversal");
+  return search->second;
+}
+
+llvm::Instruction *BlockNumbering::get_entry(llvm::Function *F,
+                                             unsigned index) const {
+  auto search = entries.find(F);
+  assert(search != entries.end() && index < search->second.size());
+  return search->second[index];
+}
@@ -0,0 +1,56 @@
+/*
+  Copyright 2020 Tim Jammer
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+       http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.
+ */
+
+#ifndef MACH_BLOCK_NUMBERING_H_
+#define MACH_BLOCK_NUMBERING_H_
+
+#include "llvm/ADT/DenseMap.h"
+#include "llvm/IR/Instruction.h"
+#include "llvm/IR/Module.h"
+
+#include <vector>
+
+// assigns a dense index (per function) to every point where the traversal of
+// the conflict detection may start following a code path:
+// the start of every block and the point after every call of a function
+// defined in this module (where the traversal continues, if the callee
+// returns)
+// blocks come first in layout order, so the index of a block is its position
+// in the function
+class BlockNumbering {
+public:
+  BlockNumbering(llvm::Module &M);
+  ~BlockNumbering(){};
+
+  unsigned get_num_entries(llvm::Function *F) const;
+
+  bool is_entry(llvm::Instruction *inst) const {
+    return indices.find(inst) != indices.end();
+  }
+  // index within the function of the entry point
+  unsigned get_index(llvm::Instruction *entry) const;
+  unsigned get_index(llvm::BasicBlock *bb) const {
+    return get_index(bb->getFirstNonPHI());
+  }
+
+  llvm::Instruction *get_entry(llvm::Function *F, unsigned index) const;
+
+private:
+  llvm::DenseMap<llvm::Function *, std::vector<llvm::Instruction *>> entries;
+  llvm::DenseMap<llvm::Instruction *, unsigned> indices;
+};
+
+#endif /* MACH_BLOCK_NUMBERING_H_ */
@@ -0,0 +1,308 @@
+/*
+  Copyright 2020 Tim Jammer
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+       http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.
+ */
+
+#include "communication_summary.h"
+#include "analysis_context.h"
+#include "conflict_detection.h"
+#include "mpi_functions.h"
+
+#include "llvm/ADT/DenseMap.h"
+#include "llvm/IR/Constants.h"
+#include "llvm/IR/InstrTypes.h"
+#include "llvm/IR/Instructions.h"
+
+#include <algorithm>
+
+using namespace llvm;
+
+std::string describe_envelope_value(Value *value) {
+  if (auto *c = dyn_cast<ConstantInt>(value)) {
+    return "const:" + std::to_string(c->getSExtValue());
+  }
+  if (auto *global = dyn_cast<GlobalValue>(value->stripPointerCasts())) {
+    return ("global:" + global->getName()).str();
+  }
+  if (auto *arg = dyn_cast<Argument>(value)) {
+    return "arg:" + std::to_string(arg->getArgNo());
+  }
+  return "?";
+}
+
+// calls of functions, that are not defined in this module
+static bool is_external_call(const AnalysisContext &ctx, CallBase *call) {
+  auto *callee = call->getCalledFunction();
+  return get_mpi_function_kind(*ctx.mpi_func, callee) ==
+             MPIFunctionKind::NOT_MPI &&
+         ctx.function_metadata->get_properties(callee).is_unknown();
+}
+
+// the calls each analyzed call conflicts with
+using ConflictMap = DenseMap<CallBase *, std::vector<CallBase *>>;
+using ExternalCallMap = DenseMap<CallBase *, ExternalCallSummary>;
+
+// finds out for each call of a function of another module, if the messages
+// pending when the function returns are ordered by a sync point before
+// anything communicates
+// once for unknown communicators and once for each communicator of the sync
+// points of the module
+static ExternalCallMap summarize_external_calls(const AnalysisContext &ctx,
+                                                Module &M) {
+  std::vector<CallBase *> calls;
+  std::vector<Value *> comms = {nullptr};
+  for (auto &F : M) {
+    for (auto &BB : F) {
+      for (auto &I : BB) {
+        auto *call = dyn_cast<CallBase>(&I);
+        if (call == nullptr) {
+          continue;
+        }
+        auto *callee = call->getCalledFunction();
+        if (is_external_call(ctx, call)) {
+          calls.push_back(call);
+        } else if (get_mpi_function_kind(*ctx.mpi_func, callee) ==
+                       MPIFunctionKind::SYNC &&
+                   callee != ctx.mpi_func->mpi_finalize) {
+          Value *comm = get_communicator(*ctx.mpi_func, call);
+          if (isa<Constant>(comm) &&
+              std::find(comms.begin(), comms.end(), comm) == comms.end()) {
+            comms.push_back(comm);
+          }
+        }
+      }
+    }
+  }
+
+  ExternalCallMap result;
+  for (auto *call : calls) {
+    auto *callee = call->getCalledFunction();
+    result[call].callee =
+        callee != nullptr ? callee->getName().str() : "<indirect>";
+  }
+  if (calls.empty()) {
+    return result;
+  }
+
+  for (auto *comm : comms) {
+    std::vector<AnalyzedCall> to_analyze;
+    for (auto *call : calls) {
+      AnalyzedCall analyzed;
+      analyzed.call = call;
+      analyzed.comm = comm;
+      analyzed.guard = nullptr;
+      analyzed.way_to_take = false;
+      to_analyze.push_back(std::move(analyzed));
+    }
+    auto reachable = ctx.pending_messages->solve(to_analyze);
+    for (unsigned int i = 0; i < calls.size(); ++i) {
+      if (!reachable[i].potential_conflicts.empty() ||
+          !reachable[i].conflicting_calls.empty()) {
+        continue;
+      }
+      auto &summary = result[calls[i]];
+      if (comm == nullptr) {
+        summary.is_synced = true;
+      } else {
+        summary.synced_comms.push_back(describe_envelope_value(comm));
+      }
+    }
+  }
+  return result;
+}
+
+static ConflictMap get_conflict_map(const ConflictList &conflicts) {
+  ConflictMap result;
+  for (const auto &conflict : conflicts) {
+    result[conflict.first].push_back(conflict.second);
+  }
+  return result;
+}
+
+static void add_conflicts(const AnalysisContext &ctx, MessageSummary &message,
+                          CallBase *call, const ConflictMap &conflicts) {
+  for (auto *conflict_call : conflicts.lookup(call)) {
+    auto *callee = conflict_call->getCalledFunction();
+    if (is_external_call(ctx, conflict_call)) {
+      // only known when the summaries are combined
+      std::string name =
+          callee != nullptr ? callee->getName().str() : "<indirect>";
+      if (std::find(message.pending_calls.begin(), message.pending_calls.end(),
+                    name) == message.pending_calls.end()) {
+        message.pending_calls.push_back(name);
+      }
+    } else {
+      message.has_local_conflict = true;
+    }
+  }
+
+  if (auto *reachable = ctx.conflict_cache->lookup_reachable(call)) {
+    for (auto *function : reachable->pending_at_return) {
+      message.pending_at_return.push_back(function->getName().str());
+    }
+    // the set is ordered by address
+    std::sort(message.pending_at_return.begin(),
+              message.pending_at_return.end());
+  }
+}
+
+static MessageSummary summarize_message(const AnalysisContext &ctx,
+                                        CallBase *call, bool is_send,
+                                        const ConflictMap *conflicts) {
+  const auto &mpi_func = *ctx.mpi_func;
+  MessageSummary result;
+  result.mpi_function = call->getCalledFunction()->getName().str();
+  result.is_send = is_send;
+  result.comm = describe_envelope_value(get_communicator(mpi_func, call));
+  result.peer = describe_envelope_value(get_src(mpi_func, call, is_send));
+  result.tag = describe_envelope_value(get_tag(mpi_func, call, is_send));
+
+  if (has_mpi_argument(mpi_func, call->getCalledFunction(),
+                       MPIArgument::Request, is_send)) {
+    Value *req =
+        get_mpi_argument(mpi_func, call, MPIArgument::Request, is_send);
+    result.escapes_scope = true;
+    for (auto *completion : ctx.request_completions->get_completions(req)) {
+      if (completion->getFunction() == call->getFunction()) {
+        result.escapes_scope = false;
+      }
+    }
+  }
+
+  if (conflicts != nullptr) {
+    add_conflicts(ctx, result, call, *conflicts);
+  }
+  return result;
+}
+
+static FunctionSummary
+summarize_function(const AnalysisContext &ctx, Function &F,
+                   const ConflictMap *send_conflicts,
+                   const ConflictMap *recv_conflicts,
+                   const ExternalCallMap *external_calls) {
+  FunctionSummary result;
+  result.name = F.getName().str();
+  result.is_local = F.hasLocalLinkage();
+  result.properties = ctx.function_metadata->get_properties(&F);
+
+  for (auto &BB : F) {
+    for (auto &I : BB) {
+      auto *call = dyn_cast<CallBase>(&I);
+      if (call == nullptr) {
+        continue;
+      }
+      auto *callee = call->getCalledFunction();
+      const auto kind = get_mpi_function_kind(*ctx.mpi_func, callee);
+      if (kind == MPIFunctionKind::SEND) {
+        result.messages.push_back(
+            summarize_message(ctx, call, true, send_conflicts));
+      } else if (kind == MPIFunctionKind::RECV) {
+        result.messages.push_back(
+            summarize_message(ctx, call, false, recv_conflicts));
+      } else if (kind == MPIFunctionKind::SENDRECV) {
+        result.messages.push_back(
+            summarize_message(ctx, call, true, send_conflicts));
+        result.messages.push_back(
+            summarize_message(ctx, call, false, recv_conflicts));
+      } else if (is_sync_kind(kind)) {
+        SyncSummary sync;
+        sync.mpi_function = callee->getName().str();
+        if (callee != ctx.mpi_func->mpi_finalize) {
+          sync.comm =
+              describe_envelope_value(get_communicator(*ctx.mpi_func, call));
+        }
+        result.syncs.push_back(sync);
+      } else if (is_external_call(ctx, call)) {
+        result.unknown_callees.push_back(
+            callee != nullptr ? callee->getName().str() : "<indirect>");
+        if (external_calls != nullptr) {
+          result.external_calls.push_back(external_calls->lookup(call));
+        }
+      } else if (kind == MPIFunctionKind::NOT_MPI &&
+                 !callee->isDeclaration() &&
+                 std::find(result.callees.begin(), result.callees.end(),
+                           callee->getName()) == result.callees.end()) {
+        result.callees.push_back(callee->getName().str());
+      }
+    }
+  }
+
+  return result;
+}
+
+ModuleSummary summarize_communication(const AnalysisContext &ctx, Module &M,
+                                      const ConflictList *send_conflicts,
+                                      const ConflictList *recv_conflicts) {
+  ModuleSummary result;
+  result.module_name = M.getName().str();
+
+  const bool with_conflicts =
+      send_conflicts != nullptr && recv_conflicts != nullptr;
+  ConflictMap send_map, recv_map;
+  ExternalCallMap external_calls;
+  if (with_conflicts) {
+    send_map = get_conflict_map(*send_conflicts);
+    recv_map = get_conflict_map(*recv_conflicts);
+    external_calls = summarize_external_calls(ctx, M);
+  }
+
+  for (auto &F : M) {
+    if (F.isDeclaration()) {
+      continue;
+    }
+    result.functions.push_back(summarize_function(
+        ctx, F, with_conflicts ? &send_map : nullptr,
+        with_conflicts ? &recv_map : nullptr,
+        with_conflicts ? &external_calls : nullptr));
+  }
+
+  return result;
+}
+
+void ModuleSummary::print(raw_ostream &os) const {
+  os << "Communication summary of " << module_name << ":\n";
+  for (const auto &function : functions) {
+    if (function.messages.empty() && function.syncs.empty() &&
+        function.unknown_callees.empty() && !function.properties.has_mpi()) {
+      continue;
+    }
+    os << "function " << function.name << ":";
+    if (function.properties.may_conflict()) {
+      os << " may_conflict";
+    }
+    if (function.properties.will_sync()) {
+      os << " will_sync";
+    }
+    os << "\n";
+    for (const auto &message : function.messages) {
+      os << "  " << (message.is_send ? "send " : "recv ")
+         << message.mpi_function << " comm=" << message.comm
+         << " peer=" << message.peer << " tag=" << message.tag;
+      if (message.escapes_scope) {
+        os << " (scope escapes)";
+      }
+      os << "\n";
+    }
+    for (const auto &sync : function.syncs) {
+      os << "  sync " << sync.mpi_function;
+      if (!sync.comm.empty()) {
+        os << " comm=" << sync.comm;
+      }
+      os << "\n";
+    }
+    for (const auto &callee : function.unknown_callees) {
+      os << "  calls unknown " << callee << "\n";
+    }
+  }
+}
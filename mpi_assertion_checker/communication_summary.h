@@ -0,0 +1,129 @@
+/*
+  Copyright 2020 Tim Jammer
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+       http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.
+ */
+
+#ifndef MACH_COMMUNICATION_SUMMARY_H_
+#define MACH_COMMUNICATION_SUMMARY_H_
+
+#include "llvm/IR/Function.h"
+#include "llvm/IR/InstrTypes.h"
+#include "llvm/IR/Module.h"
+#include "llvm/Support/raw_ostream.h"
+
+#include "function_coverage.h"
+
+#include <string>
+#include <utility>
+#include <vector>
+
+struct AnalysisContext;
+
+// summary of the communication of a module, that does not contain the whole
+// program (library mode), e.g. a translation unit of a library that is
+// initialized elsewhere
+// instead of a verdict, it describes what each function communicates, so that
+// the summaries of all parts of the program can be combined later
+
+// the values of the message envelope are described symbolically:
+// "const:<value>" for integer constants, "global:<name>" for globals (e.g.
+// predefined communicators), "arg:<index>" for arguments of the function and
+// "?" for anything else
+std::string describe_envelope_value(llvm::Value *value);
+
+struct MessageSummary {
+  // name of the MPI function
+  std::string mpi_function;
+  bool is_send = false;
+  std::string comm;
+  std::string peer;
+  std::string tag;
+  // nonblocking call that is not completed within the function
+  bool escapes_scope = false;
+
+  // only known if the conflicts were checked (see summarize_communication)
+  // conflicts with other MPI calls of the module
+  bool has_local_conflict = false;
+  // functions not defined in this module, that are called while the message
+  // may be pending (a conflict if they communicate with a matching envelope)
+  std::vector<std::string> pending_calls;
+  // functions of this module, that may return into another module while the
+  // message may still be pending
+  std::vector<std::string> pending_at_return;
+};
+
+// a call of a function, that is not defined in this module
+// only known if the conflicts were checked
+struct ExternalCallSummary {
+  std::string callee;
+  // messages still pending when the callee returns are ordered by a sync
+  // point, before anything communicates (regardless of their communicator)
+  bool is_synced = false;
+  // the communicators, for which this holds
+  std::vector<std::string> synced_comms;
+};
+
+struct SyncSummary {
+  std::string mpi_function;
+  std::string comm;
+};
+
+struct FunctionSummary {
+  std::string name;
+  // local linkage: the name is only visible within the module
+  bool is_local = false;
+  FunctionProperties properties;
+  // the MPI calls of the function itself (calls of other functions of the
+  // module are only included in the properties)
+  std::vector<MessageSummary> messages;
+  std::vector<SyncSummary> syncs;
+  // called functions, that are defined in this module
+  std::vector<std::string> callees;
+  // called functions, that are not defined in this module and may
+  // communicate
+  std::vector<std::string> unknown_callees;
+  std::vector<ExternalCallSummary> external_calls;
+};
+
+struct ModuleSummary {
+  std::string module_name;
+  // all defined functions, so that calls from other modules can be resolved
+  std::vector<FunctionSummary> functions;
+
+  // the conflicts and the other assertions were checked
+  bool is_checked = false;
+  bool no_any_tag = false;
+  bool no_any_source = false;
+  bool exact_length = false;
+
+  // only prints the functions that communicate or call unknown functions
+  void print(llvm::raw_ostream &os) const;
+};
+
+// the result of the conflict detection (the analyzed call first)
+using ConflictList = std::vector<std::pair<llvm::CallBase *, llvm::CallBase *>>;
+
+// function_metadata and request_completions of ctx need to be set up
+// beforehand
+// if the conflicts found by the conflict detection are given (without
+// stopping at the first one), the messages are annotated with them and the
+// calls of functions of other modules are analyzed, then the state of the
+// conflict detection needs to be set up (conflict_cache holding the pending
+// messages of each call)
+ModuleSummary summarize_communication(const AnalysisContext &ctx,
+                                      llvm::Module &M,
+                                      const ConflictList *send_conflicts,
+                                      const ConflictList *recv_conflicts);
+
+#endif /* MACH_COMMUNICATION_SUMMARY_H_ */
@@ -0,0 +1,71 @@
+/*
+  Copyright 2020 Tim Jammer
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+       http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.
+ */
+
+#include "conflict_cache.h"
+
+using namespace llvm;
+
+const ReachabilitySummary *ConflictCache::lookup_reachable(CallBase *call) {
+  auto search = reachable.find(call);
+  if (search != reachable.end()) {
+    return &search->second;
+  } else {
+    return nullptr;
+  }
+}
+
+void ConflictCache::insert_reachable(CallBase *call,
+                                     ReachabilitySummary summary) {
+  reachable.insert(std::make_pair(call, std::move(summary)));
+}
+
+const bool *ConflictCache::lookup_verdict(CallBase *a, CallBase *b,
+                                          bool is_send) {
+  auto search = verdicts.find(std::make_tuple(a, b, is_send));
+  if (search != verdicts.end()) {
+    return &search->second.is_conflicting;
+  }
+  search = verdicts.find(std::make_tuple(b, a, is_send));
+  if (search != verdicts.end() && search->second.is_symmetric) {
+    return &search->second.is_conflicting;
+  }
+  return nullptr;
+}
+
+void ConflictCache::insert_verdict(CallBase *a, CallBase *b, bool is_send,
+                                   bool is_conflicting, bool is_symmetric) {
+  verdicts.insert(std::make_pair(std::make_tuple(a, b, is_send),
+                                 Verdict{is_conflicting, is_symmetric}));
+}
+
+const bool *
+ConflictCache::lookup_difference(Value *a, Value *b,
+                                 bool check_for_loop_iter_difference) {
+  auto search =
+      differences.find(std::make_tuple(a, b, check_for_loop_iter_difference));
+  if (search != differences.end()) {
+    return &search->second;
+  } else {
+    return nullptr;
+  }
+}
+
+void ConflictCache::insert_difference(Value *a, Value *b,
+                                      bool check_for_loop_iter_difference,
+                                      bool is_different) {
+  differences.insert(std::make_pair(
+      std::make_tuple(a, b, check_for_loop_iter_difference), is_different));
+}
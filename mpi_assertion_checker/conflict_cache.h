@@ -0,0 +1,76 @@
+/*
+  Copyright 2020 Tim Jammer
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+       http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.
+ */
+
+#ifndef MACH_CONFLICT_CACHE_H_
+#define MACH_CONFLICT_CACHE_H_
+
+#include "llvm/ADT/DenseMap.h"
+#include "llvm/IR/InstrTypes.h"
+
+#include "reachability_summaries.h"
+
+#include <map>
+#include <tuple>
+
+// results of the conflict detection that are shared between the send and the
+// recv phase
+// - the calls reachable from each analyzed call site, so that e.g. a
+//   Sendrecv is only traversed once for both of its parts
+// - the verdict for each pair of calls (from the analyzed call to the found
+//   one), so that a pair that reaches each other is only compared once, if
+//   the verdict does not depend on the direction
+// - whether two values (e.g. tags) are proven to be different, as the same
+//   values are compared for many pairs of calls
+// only used from the serial parts of the conflict detection
+class ConflictCache {
+public:
+  ConflictCache(){};
+  ~ConflictCache(){};
+
+  // nullptr if not computed yet
+  const ReachabilitySummary *lookup_reachable(llvm::CallBase *call);
+  void insert_reachable(llvm::CallBase *call, ReachabilitySummary summary);
+
+  // the verdict from a to b, or from b to a if it does not depend on the
+  // direction
+  // nullptr if not decided yet
+  const bool *lookup_verdict(llvm::CallBase *a, llvm::CallBase *b,
+                             bool is_send);
+  // is_symmetric: the verdict from b to a is the same
+  void insert_verdict(llvm::CallBase *a, llvm::CallBase *b, bool is_send,
+                      bool is_conflicting, bool is_symmetric);
+
+  // nullptr if not decided yet
+  const bool *lookup_difference(llvm::Value *a, llvm::Value *b,
+                                bool check_for_loop_iter_difference);
+  void insert_difference(llvm::Value *a, llvm::Value *b,
+                         bool check_for_loop_iter_difference,
+                         bool is_different);
+
+private:
+  using PairKey = std::tuple<llvm::CallBase *, llvm::CallBase *, bool>;
+  struct Verdict {
+    bool is_conflicting;
+    bool is_symmetric;
+  };
+
+  llvm::DenseMap<llvm::CallBase *, ReachabilitySummary> reachable;
+  std::map<PairKey, Verdict> verdicts;
+  // not symmetric, as the analysis of the first value is used
+  std::map<std::tuple<llvm::Value *, llvm::Value *, bool>, bool> differences;
+};
+
+#endif /* MACH_CONFLICT_CACHE_H_ */
@@ -19,16 +19,29 @@
 
 #include "llvm/IR/InstrTypes.h"
 
+#include "analysis_context.h"
+
 #include <vector>
 
+// the state of the conflict detection in ctx needs to be set up beforehand
+// if stop_at_first: only the first conflict found is returned
 std::vector<std::pair<llvm::CallBase *, llvm::CallBase *>>
-check_mpi_recv_conflicts(llvm::Module &M);
+check_mpi_recv_conflicts(AnalysisContext &ctx, llvm::Module &M,
+                         bool stop_at_first);
 
 std::vector<std::pair<llvm::CallBase *, llvm::CallBase *>>
-check_mpi_send_conflicts(llvm::Module &M);
-
-llvm::Value *get_communicator(llvm::CallBase *mpi_call);
-llvm::Value *get_src(llvm::CallBase *mpi_call, bool is_send);
-llvm::Value *get_tag(llvm::CallBase *mpi_call, bool is_send);
+check_mpi_send_conflicts(AnalysisContext &ctx, llvm::Module &M,
+                         bool stop_at_first);
+
+llvm::Value *get_communicator(const struct mpi_functions &mpi_func,
+                              llvm::CallBase *mpi_call);
+llvm::Value *get_src(const struct mpi_functions &mpi_func,
+                     llvm::CallBase *mpi_call, bool is_send);
+llvm::Value *get_tag(const struct mpi_functions &mpi_func,
+                     llvm::CallBase *mpi_call, bool is_send);
+
+// the calls completing the given nonblocking call (e.g. MPI_Wait)
+std::vector<llvm::CallBase *>
+get_corresponding_wait(const AnalysisContext &ctx, llvm::CallBase *call);
 
 #endif /* MACH_CONFLICT_DETECTION_H_ */
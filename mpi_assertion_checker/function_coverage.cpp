@@ -15,122 +15,244 @@
  */
 
 #include "function_coverage.h"
+#include "analysis_cache.h"
 #include "mpi_functions.h"
 
-#include "llvm/IR/InstIterator.h"
+#include "llvm/ADT/SCCIterator.h"
+#include "llvm/Analysis/CallGraph.h"
+#include "llvm/IR/ModuleSummaryIndex.h"
+
+#include <vector>
 
 #include "debug.h"
 
 using namespace llvm;
 
-FunctionMetadata::FunctionMetadata(const llvm::TargetLibraryInfo *TLI,
-                                   llvm::Module &M) {
+// the summary of the definition of the function in the index (if any)
+static const FunctionSummary *
+get_function_summary(const ModuleSummaryIndex &index, GlobalValue::GUID guid) {
+  auto VI = index.getValueInfo(guid);
+  if (!VI) {
+    return nullptr;
+  }
+  for (const auto &summary : VI.getSummaryList()) {
+    // aliases are resolved, all copies of the definition are the same
+    if (auto *FS = dyn_cast<FunctionSummary>(summary->getBaseObject())) {
+      return FS;
+    }
+  }
+  return nullptr;
+}
 
-  assert(mpi_func != nullptr);
+// the properties of the functions defined in other modules of the program
+// they are computed from the call graph of the ThinLTO combined summary index
+// in the same way as for the functions of this module: indirect calls are
+// ignored and the unknown flag is not inherited
+// the flags only grow, so each function is visited a bounded number of times
+static DenseMap<GlobalValue::GUID, FunctionProperties>
+get_index_properties(const ModuleSummaryIndex &index,
+                     const std::vector<GlobalValue::GUID> &declarations) {
+  DenseMap<GlobalValue::GUID, FunctionProperties> result;
+  DenseMap<GlobalValue::GUID, std::vector<GlobalValue::GUID>> callers;
+
+  // all defined functions reachable from the declarations
+  std::vector<GlobalValue::GUID> worklist;
+  for (auto guid : declarations) {
+    if (get_function_summary(index, guid) != nullptr &&
+        result.find(guid) == result.end()) {
+      result[guid].flags = 0;
+      worklist.push_back(guid);
+    }
+  }
+  std::vector<GlobalValue::GUID> reached = worklist;
+  while (!worklist.empty()) {
+    const auto guid = worklist.back();
+    worklist.pop_back();
+    // result may grow in the loop, so it is only updated afterwards
+    FunctionProperties info;
+    info.flags = 0;
+    for (const auto &edge : get_function_summary(index, guid)->calls()) {
+      const auto callee = edge.first.getGUID();
+      const auto kind = get_mpi_function_kind_by_guid(callee);
+      if (kind != MPIFunctionKind::NOT_MPI) {
+        info.flags |= FunctionProperties::HAS_MPI;
+        if (is_sync_kind(kind)) {
+          info.flags |= FunctionProperties::HAS_SYNC;
+        }
+        if (is_conflicting_kind(kind)) {
+          info.flags |= FunctionProperties::MAY_CONFLICT;
+        }
+      } else if (get_function_summary(index, callee) != nullptr) {
+        callers[callee].push_back(guid);
+        if (result.find(callee) == result.end()) {
+          result[callee].flags = 0;
+          worklist.push_back(callee);
+          reached.push_back(callee);
+        }
+      }
+      // functions without a definition in the program are ignored
+    }
+    result[guid] = info;
+  }
+
+  // the callers include the flags of their callees
+  worklist = reached;
+  while (!worklist.empty()) {
+    const auto guid = worklist.back();
+    worklist.pop_back();
+    const auto flags = result[guid].flags;
+    for (auto caller : callers.lookup(guid)) {
+      auto &caller_info = result[caller];
+      if ((caller_info.flags | flags) != caller_info.flags) {
+        caller_info.flags |= flags;
+        worklist.push_back(caller);
+      }
+    }
+  }
+
+  return result;
+}
+
+FunctionMetadata::FunctionMetadata(const struct mpi_functions &mpi_func,
+                                   const llvm::TargetLibraryInfo *TLI,
+                                   llvm::Module &M,
+                                   const llvm::ModuleSummaryIndex *index,
+                                   const AnalysisCache *cache) {
 
   LibFunc libF;
+  // functions not defined in this module
+  std::vector<Function *> declarations;
   for (auto &F : M) {
 
+    // the SCCs of the call graph skip the functions already present
+    FunctionProperties cached;
+    if (cache != nullptr && cache->lookup_properties(&F, cached)) {
+      this->function_metadata.insert(std::make_pair(&F, cached));
+      continue;
+    }
+
     // if one of this attr: no conflict possible
     bool has_certain_attr = F.hasFnAttribute(Attribute::NoReturn);
 
     if (has_certain_attr || F.isIntrinsic() || TLI->getLibFunc(F, libF) ||
-        is_mpi_function(&F)) {
+        is_mpi_function(mpi_func, &F)) {
       // errs() << F.getName() << " is part of stdlibs or an MPI call\n";
       // we consider MPi calls themselves to not include any forther mpi
       // commands, as they will be handeled differently form other function
-      // calls anyway unknown, has mpi, has sync, may conflict
-      auto info = std::make_tuple(false, false, false, false);
+      // calls anyway
+      FunctionProperties info;
+      info.flags = 0;
       const auto status =
           this->function_metadata.insert(std::make_pair(&F, info));
       assert(status.second && "Successfully inserted into map");
 
-    } else {
+    } else if (F.isDeclaration()) {
       // errs() << F.getName() << " is user defined (or another library )\n";
-      // to be analyezed if opposite holds:
-      bool unknown = false;
-      bool has_mpi = false;
-      bool has_sync = false;
-      bool may_conflict = false;
-
-      if (F.isDeclaration()) {
-        // not defined in this module
-        unknown = true;
-      } else {
-        for (inst_iterator I = inst_begin(&F), E = inst_end(&F); I != E; ++I) {
-
-          if (auto *call = dyn_cast<CallBase>(&*I)) {
-            if (is_mpi_call(call)) {
-              has_mpi = true;
-              if (mpi_func->sync_functions.find(call->getCalledFunction()) !=
-                  mpi_func->sync_functions.end()) {
-                has_sync = true;
-              }
-              if (mpi_func->conflicting_functions.find(
-                      call->getCalledFunction()) !=
-                  mpi_func->conflicting_functions.end()) {
-                may_conflict = true;
-              }
-            }
+      declarations.push_back(&F);
+    }
+    // all other functions are analyzed below
+  }
+
+  // not defined in this module: unknown, unless the combined summary index
+  // knows the definition in another module of the program
+  DenseMap<GlobalValue::GUID, FunctionProperties> index_properties;
+  if (index != nullptr) {
+    std::vector<GlobalValue::GUID> guids;
+    for (auto *F : declarations) {
+      guids.push_back(F->getGUID());
+    }
+    index_properties = get_index_properties(*index, guids);
+  }
+  for (auto *F : declarations) {
+    FunctionProperties info;
+    info.flags = FunctionProperties::UNKNOWN;
+    auto search = index_properties.find(F->getGUID());
+    if (search != index_properties.end()) {
+      info = search->second;
+    }
+    const auto status =
+        this->function_metadata.insert(std::make_pair(F, info));
+    assert(status.second && "Successfully inserted into map");
+  }
+
+  // visit the SCCs of the call graph bottom up, so that the metadata of all
+  // called functions is already known when analyzing the caller
+  // this way, MPI calls hidden in multiple layers of function calls are found
+  // all functions within one SCC (recursion) get the same metadata
+  CallGraph CG(M);
+  for (auto scc = scc_begin(&CG); !scc.isAtEnd(); ++scc) {
+    std::vector<Function *> scc_functions;
+    FunctionProperties info;
+    info.flags = 0;
+
+    for (CallGraphNode *node : *scc) {
+      Function *F = node->getFunction();
+      if (F == nullptr ||
+          function_metadata.find(F) != function_metadata.end()) {
+        // external node or already handled above
+        continue;
+      }
+      scc_functions.push_back(F);
+
+      for (auto &call_record : *node) {
+        Function *callee = call_record.second->getFunction();
+        if (callee == nullptr) {
+          // indirect call
+          continue;
+        }
+        const auto kind = get_mpi_function_kind(mpi_func, callee);
+        if (kind != MPIFunctionKind::NOT_MPI) {
+          info.flags |= FunctionProperties::HAS_MPI;
+          if (is_sync_kind(kind)) {
+            info.flags |= FunctionProperties::HAS_SYNC;
+          }
+          if (is_conflicting_kind(kind)) {
+            info.flags |= FunctionProperties::MAY_CONFLICT;
+          }
+        } else {
+          // functions of the same SCC are not analyzed yet, but their calls
+          // are included in this SCC anyway
+          auto search = function_metadata.find(callee);
+          // the unknown flag is not inherited
+          if (search != function_metadata.end()) {
+            info.flags |= search->second.flags & ~FunctionProperties::UNKNOWN;
           }
         }
       }
+    }
 
-      Debug(errs() << F.getName() << ":unknown: " << unknown
-                   << " has_mpi: " << has_mpi << " will_sync: " << has_sync
-                   << " may_conflict" << may_conflict << "\n";);
-      auto info = std::make_tuple(unknown, has_mpi, has_sync, may_conflict);
+    for (auto *F : scc_functions) {
+      Debug(errs() << F->getName() << ":unknown: " << info.is_unknown()
+                   << " has_mpi: " << info.has_mpi()
+                   << " will_sync: " << info.will_sync()
+                   << " may_conflict" << info.may_conflict() << "\n";);
       const auto status =
-          this->function_metadata.insert(std::make_pair(&F, info));
+          this->function_metadata.insert(std::make_pair(F, info));
       assert(status.second && "Successfully inserted into map");
     }
   }
 }
 
-bool FunctionMetadata::has_mpi(llvm::Function *F) {
-
+FunctionProperties FunctionMetadata::get_properties(llvm::Function *F) const {
   auto search = this->function_metadata.find(F);
   if (search != function_metadata.end()) {
-    auto info = search->second;
-
-    // unknown || has_mpi
-    return std::get<0>(info) || std::get<1>(info);
+    return search->second;
   } else {
     // no analysis for this function present: assuming the worst
-    return true;
+    return FunctionProperties();
   }
 }
-bool FunctionMetadata::may_conflict(llvm::Function *F) {
-  auto search = this->function_metadata.find(F);
-  if (search != function_metadata.end()) {
-    auto info = search->second;
-    // unknown || may_conflict
-    return std::get<0>(info) || std::get<3>(info);
-  } else {
-    // no analysis for this function present: assuming the worst
-    return true;
-  }
+
+bool FunctionMetadata::has_mpi(llvm::Function *F) const {
+  return get_properties(F).has_mpi();
 }
-bool FunctionMetadata::will_sync(llvm::Function *F) {
-  auto search = this->function_metadata.find(F);
-  if (search != function_metadata.end()) {
-    auto info = search->second;
-    // ! unknown && will_sync
-    return !std::get<0>(info) && std::get<2>(info);
-  } else {
-    // no analysis for this function present: assuming the worst
-    return false;
-  }
+bool FunctionMetadata::may_conflict(llvm::Function *F) const {
+  return get_properties(F).may_conflict();
+}
+bool FunctionMetadata::will_sync(llvm::Function *F) const {
+  return get_properties(F).will_sync();
 }
 
-bool FunctionMetadata::is_unknown(llvm::Function *F) {
-  auto search = this->function_metadata.find(F);
-  if (search != function_metadata.end()) {
-    auto info = search->second;
-    // unknown
-    return std::get<0>(info);
-  } else {
-    // no analysis for this function present: unknown
-    return true;
-  }
+bool FunctionMetadata::is_unknown(llvm::Function *F) const {
+  return get_properties(F).is_unknown();
 }
@@ -17,36 +17,66 @@
 #ifndef MACH_FUNCTION_COVERAGE_H_
 #define MACH_FUNCTION_COVERAGE_H_
 
+#include "llvm/ADT/DenseMap.h"
 #include "llvm/Analysis/TargetLibraryInfo.h"
 #include "llvm/IR/Function.h"
 
-#include <map>
-#include <tuple>
+#include "mpi_functions.h"
+
+#include <cstdint>
+
+// only declared, as its FunctionSummary would clash with the one of the
+// communication summary
+namespace llvm {
+class ModuleSummaryIndex;
+}
+
+class AnalysisCache;
+
+// the result of the analysis of one function as bit flags
+// unknown means definition not within this module and not part of stdlib (and
+// no mpi call itself)
+struct FunctionProperties {
+  enum Flags : uint8_t {
+    UNKNOWN = 1 << 0,
+    HAS_MPI = 1 << 1,
+    HAS_SYNC = 1 << 2,
+    MAY_CONFLICT = 1 << 3
+  };
+
+  uint8_t flags = UNKNOWN;
+
+  bool has_mpi() const { return flags & (UNKNOWN | HAS_MPI); }
+  bool may_conflict() const { return flags & (UNKNOWN | MAY_CONFLICT); }
+  bool will_sync() const { return !(flags & UNKNOWN) && (flags & HAS_SYNC); }
+  bool is_unknown() const { return flags & UNKNOWN; }
+};
 
 // this class does the per function analysis
 // it stores if a function uses MPI that may conflict
+// with the combined summary index of ThinLTO, functions defined in other
+// modules of the program are analyzed as well instead of being unknown
+// functions found in the analysis cache are taken from there
 class FunctionMetadata {
 public:
-  FunctionMetadata(const llvm::TargetLibraryInfo *TLI, llvm::Module &M);
+  FunctionMetadata(const struct mpi_functions &mpi_func,
+                   const llvm::TargetLibraryInfo *TLI, llvm::Module &M,
+                   const llvm::ModuleSummaryIndex *index = nullptr,
+                   const AnalysisCache *cache = nullptr);
   ~FunctionMetadata(){};
 
-  bool has_mpi(llvm::Function *F);
-  bool may_conflict(llvm::Function *F);
-  bool will_sync(llvm::Function *F);
+  // all properties at once
+  // if no analysis for this function is present, it is unknown
+  FunctionProperties get_properties(llvm::Function *F) const;
 
-  bool is_unknown(llvm::Function *F);
+  bool has_mpi(llvm::Function *F) const;
+  bool may_conflict(llvm::Function *F) const;
+  bool will_sync(llvm::Function *F) const;
 
-private:
-  // maps function to tuple of bool:
-  // unknown, has mpi, has sync, may conflict
-  // unknown means definition not within this module and not part of stdlib (and
-  // no mpi call itself)
+  bool is_unknown(llvm::Function *F) const;
 
-  std::map<llvm::Function *, std::tuple<bool, bool, bool, bool>>
-      function_metadata;
+private:
+  llvm::DenseMap<llvm::Function *, FunctionProperties> function_metadata;
 };
 
-// global will be managed by main
-extern FunctionMetadata *function_metadata;
-
 #endif /* MSG_ORDER_RELAX_CHECKER_FUNCTION_COVERAGE_H_ */
@@ -21,6 +21,7 @@
 #include "llvm/IR/Module.h"
 
 #include "llvm/Support/raw_ostream.h"
+#include "llvm/Support/xxhash.h"
 #include <mpi.h>
 
 using namespace llvm;
@@ -40,6 +41,14 @@ ImplementationSpecifics::~ImplementationSpecifics() {
   // MPI_Finalize();
 }
 
+uint64_t ImplementationSpecifics::get_profile_hash() const {
+  std::string profile;
+  raw_string_ostream os(profile);
+  os << MPI_VERSION << "." << MPI_SUBVERSION << " " << MPI_COMM_WORLD << " "
+     << MPI_ANY_SOURCE << " " << MPI_ANY_TAG;
+  return xxHash64(os.str());
+}
+
 int ImplementationSpecifics::get_size_of_mpi_type(llvm::Constant *type) {
   // TODO if DataType is no integer type, this will break...
 
@@ -18,6 +18,9 @@
 #define MACH_IMPLEMENTATION_SPECIFIC_H_
 
 #include "llvm/IR/Constant.h"
+
+#include <cstdint>
+
 class ImplementationSpecifics {
 
 public:
@@ -29,9 +32,10 @@ public:
   llvm::Constant *ANY_TAG;
 
   int get_size_of_mpi_type(llvm::Constant *type);
-};
 
-// created and deleted in main
-extern ImplementationSpecifics *mpi_implementation_specifics;
+  // identifies the MPI implementation (the constants used by the analysis),
+  // results of the analysis are only valid for the same implementation
+  uint64_t get_profile_hash() const;
+};
 
 #endif /* MACH_IMPLEMENTATION_SPECIFIC_H_ */
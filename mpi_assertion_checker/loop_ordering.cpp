@@ -0,0 +1,76 @@
+/*
+  Copyright 2020 Tim Jammer
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+       http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.
+ */
+
+#include "loop_ordering.h"
+
+#include "llvm/IR/CFG.h"
+
+using namespace llvm;
+
+bool LoopOrdering::may_precede(Loop *loop, BasicBlock *first,
+                               BasicBlock *second) {
+  const auto &loop_reachability = get_reachability(loop);
+  auto first_index = loop_reachability.index.find(first);
+  auto second_index = loop_reachability.index.find(second);
+  assert(first_index != loop_reachability.index.end() &&
+         second_index != loop_reachability.index.end() &&
+         "Blocks need to be part of the loop");
+
+  return loop_reachability.reachable[first_index->second].test(
+      second_index->second);
+}
+
+const LoopOrdering::LoopReachability &
+LoopOrdering::get_reachability(Loop *loop) {
+  auto &result = loops[loop];
+  if (result) {
+    return *result;
+  }
+
+  result.reset(new LoopReachability());
+  const auto &blocks = loop->getBlocks();
+  for (auto *bb : blocks) {
+    result->index.insert(std::make_pair(bb, result->index.size()));
+  }
+  result->reachable.resize(blocks.size(), BitVector(blocks.size()));
+
+  // fixpoint, as nested loops are still part of the loop body
+  // the blocks are in (mostly) reverse post order, so going backwards
+  // usually converges after one more iteration
+  bool changed = true;
+  while (changed) {
+    changed = false;
+    for (unsigned int i = blocks.size(); i-- > 0;) {
+      auto &reachable = result->reachable[i];
+      for (auto *succ : successors(blocks[i])) {
+        if (succ == loop->getHeader() || !loop->contains(succ)) {
+          // next iteration or leaving the loop
+          continue;
+        }
+        unsigned succ_index = result->index[succ];
+        const auto &succ_reachable = result->reachable[succ_index];
+        // test: if succ_reachable has bits not set in reachable
+        if (!reachable.test(succ_index) || succ_reachable.test(reachable)) {
+          reachable.set(succ_index);
+          reachable |= succ_reachable;
+          changed = true;
+        }
+      }
+    }
+  }
+
+  return *result;
+}
@@ -0,0 +1,54 @@
+/*
+  Copyright 2020 Tim Jammer
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+       http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.
+ */
+
+#ifndef MACH_LOOP_ORDERING_H_
+#define MACH_LOOP_ORDERING_H_
+
+#include "llvm/ADT/BitVector.h"
+#include "llvm/ADT/DenseMap.h"
+#include "llvm/Analysis/LoopInfo.h"
+#include "llvm/IR/BasicBlock.h"
+
+#include <memory>
+#include <vector>
+
+// answers if two blocks of a loop may be executed in this order within the
+// same iteration
+// for every loop, the reachability between its blocks (without the edges back
+// to the header) is computed once when the loop is first queried
+class LoopOrdering {
+public:
+  LoopOrdering(){};
+  ~LoopOrdering(){};
+
+  // true if there is a path from first to second, that does not pass the
+  // header of the loop (both blocks need to be part of the loop)
+  bool may_precede(llvm::Loop *loop, llvm::BasicBlock *first,
+                   llvm::BasicBlock *second);
+
+private:
+  struct LoopReachability {
+    llvm::DenseMap<llvm::BasicBlock *, unsigned> index;
+    // per block: the blocks reachable from it
+    std::vector<llvm::BitVector> reachable;
+  };
+
+  const LoopReachability &get_reachability(llvm::Loop *loop);
+
+  llvm::DenseMap<llvm::Loop *, std::unique_ptr<LoopReachability>> loops;
+};
+
+#endif /* MACH_LOOP_ORDERING_H_ */
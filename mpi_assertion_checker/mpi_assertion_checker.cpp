@@ -15,6 +15,8 @@
  */
 
 #include "llvm/ADT/APInt.h"
+#include "llvm/ADT/SmallString.h"
+#include "llvm/ADT/StringExtras.h"
 #include "llvm/ADT/StringRef.h"
 #include "llvm/IR/BasicBlock.h"
 #include "llvm/IR/Constants.h"
@@ -25,9 +27,17 @@
 #include "llvm/IR/Instruction.h"
 #include "llvm/IR/LegacyPassManager.h"
 #include "llvm/IR/Module.h"
+#include "llvm/IR/PassManager.h"
 #include "llvm/IR/Type.h"
 #include "llvm/Pass.h"
+#include "llvm/Passes/PassBuilder.h"
+#include "llvm/Passes/PassPlugin.h"
+#include "llvm/Support/CommandLine.h"
+#include "llvm/Support/Path.h"
+#include "llvm/Support/TimeProfiler.h"
+#include "llvm/Support/Timer.h"
 #include "llvm/Support/raw_ostream.h"
+#include "llvm/Support/xxhash.h"
 #include "llvm/Transforms/IPO/PassManagerBuilder.h"
 #include "llvm/Transforms/Utils/BasicBlockUtils.h"
 
@@ -36,45 +46,323 @@
 #include "llvm/Analysis/LoopInfo.h"
 #include "llvm/Analysis/ScalarEvolution.h"
 #include "llvm/Analysis/TargetLibraryInfo.h"
+#include "llvm/Config/llvm-config.h"
 
 #include <assert.h>
 //#include <mpi.h>
+#include <algorithm>
 #include <cstring>
+#include <memory>
 #include <utility>
 #include <vector>
 
 #include "additional_assertions.h"
-#include "analysis_results.h"
+#include "analysis_context.h"
+#include "communication_summary.h"
 #include "conflict_detection.h"
 #include "debug.h"
-#include "function_coverage.h"
-#include "implementation_specific.h"
 #include "mpi_functions.h"
+#include "summary_file.h"
 
 using namespace llvm;
 
 // declare dso_local i32 @MPI_Recv(i8*, i32, i32, i32, i32, i32,
 // %struct.MPI_Status*) #1
 
-RequiredAnalysisResults *analysis_results;
+static cl::opt<bool> FirstConflictOnly(
+    "mach-first-conflict",
+    cl::desc("Stop the conflict detection at the first conflict found, as "
+             "only the verdict is needed"),
+    cl::init(false));
+
+enum AssertionCheck {
+  CheckAllowOvertaking,
+  CheckNoAnyTag,
+  CheckNoAnySource,
+  CheckExactLength
+};
+
+static cl::list<AssertionCheck> SelectedChecks(
+    "mach-checks", cl::CommaSeparated,
+    cl::desc("Assertions to check (default: all)"),
+    cl::values(clEnumValN(CheckAllowOvertaking, "allow_overtaking",
+                          "mpi_assert_allow_overtaking (conflict detection)"),
+               clEnumValN(CheckNoAnyTag, "no_any_tag", "mpi_assert_no_any_tag"),
+               clEnumValN(CheckNoAnySource, "no_any_source",
+                          "mpi_assert_no_any_source"),
+               clEnumValN(CheckExactLength, "exact_length",
+                          "mpi_assert_exact_length")));
+
+static cl::opt<bool> LibraryMode(
+    "mach-library",
+    cl::desc("Only summarize the communication of each function, even if the "
+             "module calls MPI_Init (modules without MPI_Init are always "
+             "analyzed this way)"),
+    cl::init(false));
+
+static cl::opt<std::string> SummaryDir(
+    "mach-summary-dir",
+    cl::desc("Write the communication summary of each module into this "
+             "directory instead of checking the assertions, mach-link "
+             "combines the summaries of the whole program"),
+    cl::value_desc("directory"));
+
+static cl::opt<std::string> CacheDir(
+    "mach-cache-dir",
+    cl::desc("Keep the results of the conflict detection of each function in "
+             "this directory and reuse them in the next build if the function "
+             "(and the functions it communicates with) did not change"),
+    cl::value_desc("directory"));
+
+static cl::opt<bool>
+    TimeChecks("mach-time-checks",
+               cl::desc("Report the time spent for each assertion check"),
+               cl::init(false));
+
+static bool is_check_selected(AssertionCheck check) {
+  return SelectedChecks.empty() ||
+         std::find(SelectedChecks.begin(), SelectedChecks.end(), check) !=
+             SelectedChecks.end();
+}
+
+// the state only needed for the conflict detection
+// the traversal of the module is not needed if all results are cached
+void set_up_conflict_detection(AnalysisContext &ctx, Module &M) {
+  TimeTraceScope metadata_trace_scope("MPIFunctionMetadata", M.getName());
+  ctx.function_metadata = std::make_unique<FunctionMetadata>(
+      *ctx.mpi_func, ctx.analysis_results->getTLI(), M, ctx.combined_index,
+      ctx.analysis_cache.get());
+  ctx.conflict_cache = std::make_unique<ConflictCache>();
+  if (ctx.analysis_cache != nullptr && ctx.analysis_cache->is_complete()) {
+    return;
+  }
+
+  ctx.block_numbering = std::make_unique<BlockNumbering>(M);
+  ctx.request_completions =
+      std::make_unique<RequestCompletions>(*ctx.mpi_func, M);
+  ctx.pending_messages = std::make_unique<PendingMessages>(ctx, M);
+  ctx.loop_ordering = std::make_unique<LoopOrdering>();
+}
+
+// in reverse order, as the pending messages refer to the other parts
+void tear_down_conflict_detection(AnalysisContext &ctx) {
+  ctx.loop_ordering.reset();
+  ctx.conflict_cache.reset();
+  ctx.pending_messages.reset();
+  ctx.request_completions.reset();
+  ctx.block_numbering.reset();
+  ctx.function_metadata.reset();
+}
+
+void check_allow_overtaking(AnalysisContext &ctx, Module &M) {
+  // the summary index is not part of the hash of the cache entries
+  if (!CacheDir.empty() && ctx.combined_index == nullptr) {
+    TimeTraceScope cache_trace_scope("MPIAnalysisCache", M.getName());
+    ctx.analysis_cache = std::make_unique<AnalysisCache>(
+        CacheDir, M, ctx.mpi_implementation_specifics->get_profile_hash());
+  }
+  set_up_conflict_detection(ctx, M);
+
+  std::vector<std::pair<llvm::CallBase *, llvm::CallBase *>> send_conflicts =
+      check_mpi_send_conflicts(ctx, M, FirstConflictOnly);
+
+  std::vector<std::pair<llvm::CallBase *, llvm::CallBase *>> recv_conflicts;
+  if (!FirstConflictOnly || send_conflicts.empty()) {
+    recv_conflicts = check_mpi_recv_conflicts(ctx, M, FirstConflictOnly);
+  }
+
+  if (!send_conflicts.empty() || !recv_conflicts.empty()) {
+    /*
+        if (!send_conflicts.empty()) {
+                errs() << "send conflicts\n";
+                for (auto conflict : send_conflicts) {
+                                                        conflict.first->dump();
+                                                        conflict.second->dump();
+                                                        errs()
+<< "\n";
+                                                }
+        }
+        if (!recv_conflicts.empty()) {
+                errs() << "recv conflicts\n";
+
+                for (auto conflict : recv_conflicts) {
+                        conflict.first->dump();
+                        conflict.second->dump();
+                        errs() << "\n";
+                }
+        }
+        */
+
+    errs() << "Message race conflicts detected\n";
+  } else {
+    errs() << "No conflicts detected, try to use mpi_assert_allow_overtaking "
+              "for better performance\n";
+  }
+
+  // the conflicts of the calls are only complete if the detection did not stop
+  // at the first one
+  if (ctx.analysis_cache != nullptr && !FirstConflictOnly) {
+    if (auto error = ctx.analysis_cache->write(*ctx.function_metadata)) {
+      errs() << "Could not write the analysis cache to " << CacheDir << ": "
+             << toString(std::move(error)) << "\n";
+    }
+  }
+
+  tear_down_conflict_detection(ctx);
+  ctx.analysis_cache.reset();
+}
+
+// checks the selected assertions and prints the results
+// mpi_func and analysis_results of ctx need to be set up beforehand
+// the phases are visible with -ftime-trace, the time of each check is
+// reported with -mach-time-checks
+void check_mpi_assertions(AnalysisContext &ctx, Module &M) {
+  TimeTraceScope trace_scope("MPIAssertionChecker", M.getName());
+
+  ctx.mpi_implementation_specifics =
+      std::make_unique<ImplementationSpecifics>(M);
+
+  if (is_check_selected(CheckAllowOvertaking)) {
+    NamedRegionTimer timer("allow_overtaking", "mpi_assert_allow_overtaking",
+                           "mach", "MPI Assertion Checker", TimeChecks);
+    check_allow_overtaking(ctx, M);
+  }
+
+  if (is_check_selected(CheckNoAnyTag)) {
+    NamedRegionTimer timer("no_any_tag", "mpi_assert_no_any_tag", "mach",
+                           "MPI Assertion Checker", TimeChecks);
+    if (check_no_any_tag(ctx, M)) {
+      errs() << "You can also safely specify mpi_assert_no_any_tag for better "
+                "performance\n";
+    }
+  }
+
+  if (is_check_selected(CheckNoAnySource)) {
+    NamedRegionTimer timer("no_any_source", "mpi_assert_no_any_source",
+                           "mach", "MPI Assertion Checker", TimeChecks);
+    if (check_no_any_source(ctx, M)) {
+      errs() << "You can also safely specify mpi_assert_no_any_source for "
+                "better performance\n";
+    }
+  }
+
+  if (is_check_selected(CheckExactLength)) {
+    NamedRegionTimer timer("exact_length", "mpi_assert_exact_length", "mach",
+                           "MPI Assertion Checker", TimeChecks);
+    if (check_exact_length(ctx, M)) {
+      errs() << "You can also safely specify mpi_assert_exact_length for "
+                "better performance\n";
+    }
+  }
+
+  errs() << "Successfully executed the pass\n\n";
+  ctx.mpi_implementation_specifics.reset();
+}
+
+// prints the communication of each function instead of a verdict, as the
+// module is only a part of the program (e.g. a library)
+void summarize_library(AnalysisContext &ctx, Module &M) {
+  TimeTraceScope trace_scope("MPICommunicationSummary", M.getName());
 
-struct mpi_functions *mpi_func;
-struct ImplementationSpecifics *mpi_implementation_specifics;
-FunctionMetadata *function_metadata;
+  ctx.function_metadata = std::make_unique<FunctionMetadata>(
+      *ctx.mpi_func, ctx.analysis_results->getTLI(), M, ctx.combined_index);
+  ctx.request_completions =
+      std::make_unique<RequestCompletions>(*ctx.mpi_func, M);
+
+  summarize_communication(ctx, M, nullptr, nullptr).print(errs());
+  errs() << "Successfully executed the pass\n\n";
+
+  ctx.request_completions.reset();
+  ctx.function_metadata.reset();
+}
+
+// the summaries of different modules with the same file name are kept apart by
+// the hash of the module identifier
+std::string get_summary_file_name(Module &M) {
+  SmallString<128> path(SummaryDir);
+  sys::path::append(path, sys::path::filename(M.getModuleIdentifier()) + "-" +
+                              utohexstr(xxHash64(M.getModuleIdentifier())) +
+                              summary_file_extension);
+  return path.str().str();
+}
+
+// writes the communication summary of the module including the conflicts
+// found within the module, mach-link combines the summaries of all modules
+// and reports the verdict
+void write_summary(AnalysisContext &ctx, Module &M) {
+  TimeTraceScope trace_scope("MPICommunicationSummary", M.getName());
+
+  ctx.mpi_implementation_specifics =
+      std::make_unique<ImplementationSpecifics>(M);
+  set_up_conflict_detection(ctx, M);
+
+  // all conflicts are needed, as the ones with calls of functions of other
+  // modules may vanish when the summaries are combined
+  auto send_conflicts = check_mpi_send_conflicts(ctx, M, false);
+  auto recv_conflicts = check_mpi_recv_conflicts(ctx, M, false);
+  auto summary =
+      summarize_communication(ctx, M, &send_conflicts, &recv_conflicts);
+  summary.is_checked = true;
+  summary.no_any_tag = check_no_any_tag(ctx, M);
+  summary.no_any_source = check_no_any_source(ctx, M);
+  summary.exact_length = check_exact_length(ctx, M);
+
+  tear_down_conflict_detection(ctx);
+  ctx.mpi_implementation_specifics.reset();
+
+  const auto path = get_summary_file_name(M);
+  if (auto error = write_summary_file(summary, path)) {
+    errs() << "Could not write the communication summary to " << path << ": "
+           << toString(std::move(error)) << "\n";
+  } else {
+    errs() << "Wrote the communication summary to " << path << "\n";
+  }
+  errs() << "Successfully executed the pass\n\n";
+}
+
+enum class AnalysisMode { NONE, WHOLE_PROGRAM, LIBRARY, SUMMARY };
+
+// mpi_func of ctx needs to be set up beforehand
+AnalysisMode get_analysis_mode(AnalysisContext &ctx, Module &M) {
+  if (!SummaryDir.empty() && !M.empty()) {
+    // every module, so that calls from other modules can be resolved
+    return AnalysisMode::SUMMARY;
+  }
+  if (is_mpi_used(ctx.mpi_func.get()) && !LibraryMode) {
+    return AnalysisMode::WHOLE_PROGRAM;
+  }
+  if (is_mpi_communication_used(ctx.mpi_func.get())) {
+    // MPI is initialized elsewhere
+    return AnalysisMode::LIBRARY;
+  }
+  return AnalysisMode::NONE;
+}
+
+void run_analysis(AnalysisContext &ctx, Module &M, AnalysisMode mode) {
+  if (mode == AnalysisMode::WHOLE_PROGRAM) {
+    check_mpi_assertions(ctx, M);
+  } else if (mode == AnalysisMode::SUMMARY) {
+    write_summary(ctx, M);
+  } else {
+    assert(mode == AnalysisMode::LIBRARY);
+    summarize_library(ctx, M);
+  }
+}
 
 namespace {
 struct MSGOrderRelaxCheckerPass : public ModulePass {
   static char ID;
 
-  MSGOrderRelaxCheckerPass() : ModulePass(ID) {}
+  // in ThinLTO backends, the combined summary index is given
+  MSGOrderRelaxCheckerPass(const ModuleSummaryIndex *ImportSummary = nullptr)
+      : ModulePass(ID), ImportSummary(ImportSummary) {}
 
   // register that we require this analysis
 
+  // the function analyses (LoopInfo, SCEV) are computed and cached by
+  // RequiredAnalysisResults itself
   void getAnalysisUsage(AnalysisUsage &AU) const {
     AU.addRequired<TargetLibraryInfoWrapperPass>();
-    AU.addRequiredTransitive<AAResultsWrapperPass>();
-    AU.addRequired<LoopInfoWrapperPass>();
-    AU.addRequired<ScalarEvolutionWrapperPass>();
   }
   /*
    void getAnalysisUsage(AnalysisUsage &AU) const {
@@ -92,87 +380,72 @@ struct MSGOrderRelaxCheckerPass : public ModulePass {
 
     Debug(M.dump(););
 
-    mpi_func = get_used_mpi_functions(M);
-    if (!is_mpi_used(mpi_func)) {
+    // own state for every run, the ThinLTO backends may run concurrently
+    AnalysisContext ctx;
+    ctx.mpi_func.reset(get_used_mpi_functions(M));
+    const auto mode = get_analysis_mode(ctx, M);
+    if (mode == AnalysisMode::NONE) {
       // nothing to do for non mpi applicatiopns
-      delete mpi_func;
       return false;
     }
 
-    analysis_results = new RequiredAnalysisResults(this);
+    ctx.analysis_results = std::make_unique<RequiredAnalysisResults>(this, M);
+    ctx.combined_index = ImportSummary;
 
-    function_metadata = new FunctionMetadata(analysis_results->getTLI(), M);
+    run_analysis(ctx, M, mode);
 
-    mpi_implementation_specifics = new ImplementationSpecifics(M);
+    return false;
+  }
 
-    std::vector<std::pair<llvm::CallBase *, llvm::CallBase *>> send_conflicts =
-        check_mpi_send_conflicts(M);
+private:
+  const ModuleSummaryIndex *ImportSummary;
+}; // class MSGOrderRelaxCheckerPass
 
-    std::vector<std::pair<llvm::CallBase *, llvm::CallBase *>> recv_conflicts =
-        check_mpi_recv_conflicts(M);
+// same pass for the new pass manager
+// the function analyses are taken from the FunctionAnalysisManager, so that
+// they are cached and invalidated by the pass manager
+struct MPIAssertionCheckerPass
+    : public PassInfoMixin<MPIAssertionCheckerPass> {
 
-    if (!send_conflicts.empty() || !recv_conflicts.empty()) {
-      /*
-          if (!send_conflicts.empty()) {
-                  errs() << "send conflicts\n";
-                  for (auto conflict : send_conflicts) {
-                                                          conflict.first->dump();
-                                                          conflict.second->dump();
-                                                          errs()
-<< "\n";
-                                                  }
-          }
-          if (!recv_conflicts.empty()) {
-                  errs() << "recv conflicts\n";
-
-                  for (auto conflict : recv_conflicts) {
-                          conflict.first->dump();
-                          conflict.second->dump();
-                          errs() << "\n";
-                  }
-          }
-          */
-
-      errs() << "Message race conflicts detected\n";
-    } else {
-      errs() << "No conflicts detected, try to use mpi_assert_allow_overtaking "
-                "for better performance\n";
-    }
-
-    if (check_no_any_tag(M)) {
-      errs() << "You can also safely specify mpi_assert_no_any_tag for better "
-                "performance\n";
-    }
+  PreservedAnalyses run(Module &M, ModuleAnalysisManager &AM) {
 
-    if (check_no_any_source(M)) {
-      errs() << "You can also safely specify mpi_assert_no_any_source for "
-                "better performance\n";
-    }
+    Debug(M.dump(););
 
-    if (check_exact_length(M)) {
-      errs() << "You can also safely specify mpi_assert_exact_length for "
-                "better performance\n";
+    AnalysisContext ctx;
+    ctx.mpi_func.reset(get_used_mpi_functions(M));
+    const auto mode = get_analysis_mode(ctx, M);
+    if (mode == AnalysisMode::NONE) {
+      // nothing to do for non mpi applicatiopns
+      return PreservedAnalyses::all();
     }
 
-    errs() << "Successfully executed the pass\n\n";
-    delete mpi_func;
-    delete mpi_implementation_specifics;
-    delete analysis_results;
+    auto &FAM =
+        AM.getResult<FunctionAnalysisManagerModuleProxy>(M).getManager();
+    ctx.analysis_results = std::make_unique<RequiredAnalysisResults>(FAM, M);
 
-    delete function_metadata;
+    run_analysis(ctx, M, mode);
 
-    return false;
+    // analysis only
+    return PreservedAnalyses::all();
   }
-}; // class MSGOrderRelaxCheckerPass
+}; // class MPIAssertionCheckerPass
 } // namespace
 
 char MSGOrderRelaxCheckerPass::ID = 42;
 
 // Automatically enable the pass.
 // http://adriansampson.net/blog/clangpass.html
-static void registerExperimentPass(const PassManagerBuilder &,
+// with LTO, the compile step only prepares the module for linking, the pass
+// runs when linking instead:
+// - full LTO: on the merged module of the whole program
+// - ThinLTO: in each backend, with the combined summary index, so that the
+//   functions of other modules are not unknown
+static void registerExperimentPass(const PassManagerBuilder &Builder,
                                    legacy::PassManagerBase &PM) {
-  PM.add(new MSGOrderRelaxCheckerPass());
+  if (Builder.PrepareForLTO || Builder.PrepareForThinLTO) {
+    return;
+  }
+  PM.add(new MSGOrderRelaxCheckerPass(Builder.ImportSummary));
 }
 
 // static RegisterStandardPasses
@@ -186,3 +459,34 @@ static RegisterStandardPasses
 static RegisterStandardPasses
     RegisterMyPass0(PassManagerBuilder::EP_EnabledOnOptLevel0,
                     registerExperimentPass);
+
+// full LTO (the ThinLTO backends use EP_OptimizerLast as well)
+static RegisterStandardPasses
+    RegisterMyPassLTO(PassManagerBuilder::EP_FullLinkTimeOptimizationLast,
+                      registerExperimentPass);
+
+// new pass manager plugin:
+// opt -load-pass-plugin libmpi_assertion_checker.so
+// -passes=mpi-assertion-checker
+// it is also added at the end of the optimization pipeline
+static void registerNewPMPass(PassBuilder &PB) {
+  PB.registerPipelineParsingCallback(
+      [](StringRef Name, ModulePassManager &MPM,
+         ArrayRef<PassBuilder::PipelineElement>) {
+        if (Name == "mpi-assertion-checker") {
+          MPM.addPass(MPIAssertionCheckerPass());
+          return true;
+        }
+        return false;
+      });
+  PB.registerOptimizerLastEPCallback(
+      [](ModulePassManager &MPM, PassBuilder::OptimizationLevel Level) {
+        MPM.addPass(MPIAssertionCheckerPass());
+      });
+}
+
+extern "C" LLVM_ATTRIBUTE_WEAK ::llvm::PassPluginLibraryInfo
+llvmGetPassPluginInfo() {
+  return {LLVM_PLUGIN_API_VERSION, "MPI Assertion Analysis",
+          LLVM_VERSION_STRING, registerNewPMPass};
+}
@@ -17,18 +17,231 @@
 #include "mpi_functions.h"
 #include <assert.h>
 
+#include "llvm/ADT/StringMap.h"
 #include "llvm/IR/InstrTypes.h"
 #include <llvm/Support/raw_ostream.h>
 
 using namespace llvm;
 
-bool is_mpi_call(CallBase *call) {
-  return is_mpi_function(call->getCalledFunction());
+namespace {
+// one entry per MPI function known to the analysis
+// to support another MPI function, add it here (and to MPIFunctionId)
+struct MPIFunctionDescription {
+  const char *name;
+  MPIFunctionId id;
+  MPIFunctionKind kind;
+  // where to store the function in struct mpi_functions
+  llvm::Function *mpi_functions::*field;
+};
+
+const MPIFunctionDescription mpi_function_table[] = {
+    // should not be called twice anyway, so no need to handle it
+    {"MPI_Init", MPIFunctionId::Init, MPIFunctionKind::OTHER,
+     &mpi_functions::mpi_init},
+
+    // sync functions:
+    {"MPI_Finalize", MPIFunctionId::Finalize, MPIFunctionKind::SYNC,
+     &mpi_functions::mpi_finalize},
+    {"MPI_Barrier", MPIFunctionId::Barrier, MPIFunctionKind::SYNC,
+     &mpi_functions::mpi_barrier},
+    {"MPI_Ibarrier", MPIFunctionId::Ibarrier,
+     MPIFunctionKind::NONBLOCKING_SYNC, &mpi_functions::mpi_Ibarrier},
+    {"MPI_Allreduce", MPIFunctionId::Allreduce, MPIFunctionKind::SYNC,
+     &mpi_functions::mpi_allreduce},
+    {"MPI_Iallreduce", MPIFunctionId::Iallreduce,
+     MPIFunctionKind::NONBLOCKING_SYNC, &mpi_functions::mpi_Iallreduce},
+
+    // different sending modes:
+    {"MPI_Send", MPIFunctionId::Send, MPIFunctionKind::SEND,
+     &mpi_functions::mpi_send},
+    {"MPI_Bsend", MPIFunctionId::Bsend, MPIFunctionKind::SEND,
+     &mpi_functions::mpi_Bsend},
+    {"MPI_Ssend", MPIFunctionId::Ssend, MPIFunctionKind::SEND,
+     &mpi_functions::mpi_Ssend},
+    {"MPI_Rsend", MPIFunctionId::Rsend, MPIFunctionKind::SEND,
+     &mpi_functions::mpi_Rsend},
+    {"MPI_Isend", MPIFunctionId::Isend, MPIFunctionKind::SEND,
+     &mpi_functions::mpi_Isend},
+    {"MPI_Ibsend", MPIFunctionId::Ibsend, MPIFunctionKind::SEND,
+     &mpi_functions::mpi_Ibsend},
+    {"MPI_Issend", MPIFunctionId::Issend, MPIFunctionKind::SEND,
+     &mpi_functions::mpi_Issend},
+    {"MPI_Irsend", MPIFunctionId::Irsend, MPIFunctionKind::SEND,
+     &mpi_functions::mpi_Irsend},
+
+    {"MPI_Sendrecv", MPIFunctionId::Sendrecv, MPIFunctionKind::SENDRECV,
+     &mpi_functions::mpi_Sendrecv},
+
+    {"MPI_Recv", MPIFunctionId::Recv, MPIFunctionKind::RECV,
+     &mpi_functions::mpi_recv},
+    {"MPI_Irecv", MPIFunctionId::Irecv, MPIFunctionKind::RECV,
+     &mpi_functions::mpi_Irecv},
+
+    // Other MPI functions, that themselves may not yield another conflict
+    {"MPI_Buffer_detach", MPIFunctionId::Buffer_detach,
+     MPIFunctionKind::COMPLETION, &mpi_functions::mpi_buffer_detach},
+    {"MPI_Test", MPIFunctionId::Test, MPIFunctionKind::COMPLETION,
+     &mpi_functions::mpi_test},
+    {"MPI_Wait", MPIFunctionId::Wait, MPIFunctionKind::COMPLETION,
+     &mpi_functions::mpi_wait},
+    {"MPI_Waitall", MPIFunctionId::Waitall, MPIFunctionKind::COMPLETION,
+     &mpi_functions::mpi_waitall},
+};
+
+// position of every MPIArgument in the argument list, -1 if not present
+// sending and receiving part are distinguished for MPI_Sendrecv, functions
+// that neither send nor receive have the same positions in both parts
+struct MPIArgumentLayout {
+  unsigned int total_num_args;
+  int8_t send[static_cast<size_t>(MPIArgument::NUM_ARGUMENTS)];
+  int8_t recv[static_cast<size_t>(MPIArgument::NUM_ARGUMENTS)];
+};
+
+// in the order of MPIFunctionId
+// Buffer, Count, Type, Peer, Tag, Comm, Request
+constexpr MPIArgumentLayout mpi_argument_layouts[] = {
+    // Init
+    {2, {-1, -1, -1, -1, -1, -1, -1}, {-1, -1, -1, -1, -1, -1, -1}},
+    // Finalize
+    {0, {-1, -1, -1, -1, -1, -1, -1}, {-1, -1, -1, -1, -1, -1, -1}},
+
+    // Send, Bsend, Ssend, Rsend
+    {6, {0, 1, 2, 3, 4, 5, -1}, {-1, -1, -1, -1, -1, -1, -1}},
+    {6, {0, 1, 2, 3, 4, 5, -1}, {-1, -1, -1, -1, -1, -1, -1}},
+    {6, {0, 1, 2, 3, 4, 5, -1}, {-1, -1, -1, -1, -1, -1, -1}},
+    {6, {0, 1, 2, 3, 4, 5, -1}, {-1, -1, -1, -1, -1, -1, -1}},
+    // Isend, Ibsend, Issend, Irsend
+    {7, {0, 1, 2, 3, 4, 5, 6}, {-1, -1, -1, -1, -1, -1, -1}},
+    {7, {0, 1, 2, 3, 4, 5, 6}, {-1, -1, -1, -1, -1, -1, -1}},
+    {7, {0, 1, 2, 3, 4, 5, 6}, {-1, -1, -1, -1, -1, -1, -1}},
+    {7, {0, 1, 2, 3, 4, 5, 6}, {-1, -1, -1, -1, -1, -1, -1}},
+
+    // Sendrecv
+    {12, {0, 1, 2, 3, 4, 10, -1}, {5, 6, 7, 8, 9, 10, -1}},
+
+    // Recv (last arg is the status)
+    {7, {-1, -1, -1, -1, -1, -1, -1}, {0, 1, 2, 3, 4, 5, -1}},
+    // Irecv
+    {7, {-1, -1, -1, -1, -1, -1, -1}, {0, 1, 2, 3, 4, 5, 6}},
+
+    // Test, Wait
+    {3, {-1, -1, -1, -1, -1, -1, 0}, {-1, -1, -1, -1, -1, -1, 0}},
+    {2, {-1, -1, -1, -1, -1, -1, 0}, {-1, -1, -1, -1, -1, -1, 0}},
+    // Waitall (array of requests)
+    {3, {-1, 0, -1, -1, -1, -1, 1}, {-1, 0, -1, -1, -1, -1, 1}},
+    // Buffer_detach
+    {2, {0, -1, -1, -1, -1, -1, -1}, {0, -1, -1, -1, -1, -1, -1}},
+
+    // Barrier
+    {1, {-1, -1, -1, -1, -1, 0, -1}, {-1, -1, -1, -1, -1, 0, -1}},
+    // Allreduce (the send buffer is given)
+    {6, {0, 2, 3, -1, -1, 5, -1}, {0, 2, 3, -1, -1, 5, -1}},
+    // Ibarrier
+    {2, {-1, -1, -1, -1, -1, 0, 1}, {-1, -1, -1, -1, -1, 0, 1}},
+    // Iallreduce
+    {7, {0, 2, 3, -1, -1, 5, 6}, {0, 2, 3, -1, -1, 5, 6}},
+};
+static_assert(sizeof(mpi_argument_layouts) / sizeof(MPIArgumentLayout) ==
+                  static_cast<size_t>(MPIFunctionId::Unknown),
+              "One argument layout for every MPI function");
+
+// name -> description
+const StringMap<const MPIFunctionDescription *> &get_mpi_function_table() {
+  static const StringMap<const MPIFunctionDescription *> table = []() {
+    StringMap<const MPIFunctionDescription *> result;
+    for (const auto &description : mpi_function_table) {
+      result[description.name] = &description;
+    }
+    return result;
+  }();
+  return table;
+}
+
+// GUID of the name -> description
+const DenseMap<GlobalValue::GUID, const MPIFunctionDescription *> &
+get_mpi_function_guid_table() {
+  static const DenseMap<GlobalValue::GUID, const MPIFunctionDescription *>
+      table = []() {
+        DenseMap<GlobalValue::GUID, const MPIFunctionDescription *> result;
+        for (const auto &description : mpi_function_table) {
+          result[GlobalValue::getGUID(description.name)] = &description;
+        }
+        return result;
+      }();
+  return table;
+}
+} // namespace
+
+MPIFunctionInfo get_mpi_function_info(const struct mpi_functions &mpi_func,
+                                      const llvm::Function *f) {
+  auto search = mpi_func.function_info.find(f);
+  if (search != mpi_func.function_info.end()) {
+    return search->second;
+  } else {
+    // also for nullptr
+    return MPIFunctionInfo();
+  }
+}
+
+MPIFunctionKind get_mpi_function_kind(const struct mpi_functions &mpi_func,
+                                      const llvm::Function *f) {
+  return get_mpi_function_info(mpi_func, f).kind;
+}
+
+MPIFunctionId get_mpi_function_id(const struct mpi_functions &mpi_func,
+                                  const llvm::Function *f) {
+  return get_mpi_function_info(mpi_func, f).id;
+}
+
+MPIFunctionKind get_mpi_function_kind_by_guid(llvm::GlobalValue::GUID guid) {
+  const auto &table = get_mpi_function_guid_table();
+  auto search = table.find(guid);
+  if (search != table.end()) {
+    return search->second->kind;
+  }
+  return MPIFunctionKind::NOT_MPI;
 }
 
-bool is_mpi_function(llvm::Function *f) {
-  return f->getName().contains("MPI");
-  ;
+bool is_mpi_call(const struct mpi_functions &mpi_func, CallBase *call) {
+  return is_mpi_function(mpi_func, call->getCalledFunction());
+}
+
+bool is_mpi_function(const struct mpi_functions &mpi_func, llvm::Function *f) {
+  return get_mpi_function_kind(mpi_func, f) != MPIFunctionKind::NOT_MPI;
+}
+
+llvm::Value *get_mpi_argument(const struct mpi_functions &mpi_func,
+                              llvm::CallBase *mpi_call, MPIArgument arg,
+                              bool is_send) {
+  auto id = get_mpi_function_id(mpi_func, mpi_call->getCalledFunction());
+
+  int pos = -1;
+  if (id != MPIFunctionId::Unknown) {
+    const auto &layout = mpi_argument_layouts[static_cast<size_t>(id)];
+    assert(mpi_call->getNumArgOperands() == layout.total_num_args);
+    pos = is_send ? layout.send[static_cast<size_t>(arg)]
+                  : layout.recv[static_cast<size_t>(arg)];
+  }
+
+  if (pos < 0) {
+    errs() << mpi_call->getCalledFunction()->getName()
+           << ": This MPI function is currently not supported\n";
+    assert(false);
+    return nullptr;
+  }
+
+  return mpi_call->getArgOperand(pos);
+}
+
+bool has_mpi_argument(const struct mpi_functions &mpi_func,
+                      const llvm::Function *f, MPIArgument arg, bool is_send) {
+  auto id = get_mpi_function_id(mpi_func, f);
+  if (id == MPIFunctionId::Unknown) {
+    return false;
+  }
+  const auto &layout = mpi_argument_layouts[static_cast<size_t>(id)];
+  return (is_send ? layout.send[static_cast<size_t>(arg)]
+                  : layout.recv[static_cast<size_t>(arg)]) >= 0;
 }
 
 struct mpi_functions *get_used_mpi_functions(llvm::Module &M) {
@@ -36,81 +249,22 @@ struct mpi_functions *get_used_mpi_functions(llvm::Module &M) {
   struct mpi_functions *result = new struct mpi_functions;
   assert(result != nullptr);
 
+  const auto &table = get_mpi_function_table();
+
   for (auto it = M.begin(); it != M.end(); ++it) {
     Function *f = &*it;
-    if (f->getName().equals("MPI_Init")) {
-      result->mpi_init = f;
-      // should not be called twice anyway, so no need to handle it
-      // result->conflicting_functions.insert(f);
-
-      // sync functions:
-    } else if (f->getName().equals("MPI_Finalize")) {
-      result->mpi_finalize = f;
-      result->sync_functions.insert(f);
-    } else if (f->getName().equals("MPI_Barrier")) {
-      result->mpi_barrier = f;
-      result->sync_functions.insert(f);
-    } else if (f->getName().equals("MPI_Ibarrier")) {
-      result->mpi_Ibarrier = f;
-      result->sync_functions.insert(f);
-    } else if (f->getName().equals("MPI_Allreduce")) {
-      result->mpi_allreduce = f;
-      result->sync_functions.insert(f);
-    } else if (f->getName().equals("MPI_Iallreduce")) {
-      result->mpi_Iallreduce = f;
-      result->sync_functions.insert(f);
-    }
-
-    // different sending modes:
-    else if (f->getName().equals("MPI_Send")) {
-      result->mpi_send = f;
-      result->conflicting_functions.insert(f);
-    } else if (f->getName().equals("MPI_Bsend")) {
-      result->mpi_Bsend = f;
-      result->conflicting_functions.insert(f);
-    } else if (f->getName().equals("MPI_Ssend")) {
-      result->mpi_Ssend = f;
-      result->conflicting_functions.insert(f);
-    } else if (f->getName().equals("MPI_Rsend")) {
-      result->mpi_Rsend = f;
-      result->conflicting_functions.insert(f);
-    } else if (f->getName().equals("MPI_Isend")) {
-      result->mpi_Isend = f;
-      result->conflicting_functions.insert(f);
-    } else if (f->getName().equals("MPI_Ibsend")) {
-      result->mpi_Ibsend = f;
-      result->conflicting_functions.insert(f);
-    } else if (f->getName().equals("MPI_Issend")) {
-      result->mpi_Issend = f;
-      result->conflicting_functions.insert(f);
-    } else if (f->getName().equals("MPI_Irsend")) {
-      result->mpi_Irsend = f;
-      result->conflicting_functions.insert(f);
-
-    } else if (f->getName().equals("MPI_Sendrecv")) {
-      result->mpi_Sendrecv = f;
-      result->conflicting_functions.insert(f);
-
-    } else if (f->getName().equals("MPI_Recv")) {
-      result->mpi_recv = f;
-      result->conflicting_functions.insert(f);
-    } else if (f->getName().equals("MPI_Irecv")) {
-      result->mpi_Irecv = f;
-      result->conflicting_functions.insert(f);
-
-      // Other MPI functions, that themselves may not yield another conflict
-    } else if (f->getName().equals("MPI_Buffer_detach")) {
-      result->mpi_buffer_detach = f;
-      result->unimportant_functions.insert(f);
-    } else if (f->getName().equals("MPI_Test")) {
-      result->mpi_test = f;
-      result->unimportant_functions.insert(f);
-    } else if (f->getName().equals("MPI_Wait")) {
-      result->mpi_wait = f;
-      result->unimportant_functions.insert(f);
-    } else if (f->getName().equals("MPI_Waitall")) {
-      result->mpi_waitall = f;
-      result->unimportant_functions.insert(f);
+    auto search = table.find(f->getName());
+    if (search != table.end()) {
+      const auto *description = search->second;
+      result->*(description->field) = f;
+      MPIFunctionInfo info;
+      info.id = description->id;
+      info.kind = description->kind;
+      result->function_info[f] = info;
+    } else if (f->getName().contains("MPI")) {
+      MPIFunctionInfo info;
+      info.kind = MPIFunctionKind::OTHER;
+      result->function_info[f] = info;
     }
   }
 
@@ -126,17 +280,25 @@ bool is_mpi_used(struct mpi_functions *mpi_func) {
   }
 }
 
-bool is_send_function(llvm::Function *f) {
+bool is_mpi_communication_used(struct mpi_functions *mpi_func) {
+  for (auto &entry : mpi_func->function_info) {
+    const auto kind = entry.second.kind;
+    if ((is_conflicting_kind(kind) || is_sync_kind(kind)) &&
+        entry.first->getNumUses() > 0) {
+      return true;
+    }
+  }
+  return false;
+}
+
+bool is_send_function(const struct mpi_functions &mpi_func, llvm::Function *f) {
   assert(f != nullptr);
-  return f == mpi_func->mpi_send || f == mpi_func->mpi_Bsend ||
-         f == mpi_func->mpi_Ssend || f == mpi_func->mpi_Rsend ||
-         f == mpi_func->mpi_Isend || f == mpi_func->mpi_Ibsend ||
-         f == mpi_func->mpi_Irsend || f == mpi_func->mpi_Issend ||
-         f == mpi_func->mpi_Sendrecv;
+  auto kind = get_mpi_function_kind(mpi_func, f);
+  return kind == MPIFunctionKind::SEND || kind == MPIFunctionKind::SENDRECV;
 }
 
-bool is_recv_function(llvm::Function *f) {
+bool is_recv_function(const struct mpi_functions &mpi_func, llvm::Function *f) {
   assert(f != nullptr);
-  return f == mpi_func->mpi_recv || f == mpi_func->mpi_Irecv ||
-         f == mpi_func->mpi_Sendrecv;
+  auto kind = get_mpi_function_kind(mpi_func, f);
+  return kind == MPIFunctionKind::RECV || kind == MPIFunctionKind::SENDRECV;
 }
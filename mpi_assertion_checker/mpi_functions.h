@@ -17,16 +17,81 @@
 #ifndef MACH_MPI_FUNCTIONS_H_
 #define MACH_MPI_FUNCTIONS_H_
 
+#include "llvm/ADT/DenseMap.h"
 #include "llvm/IR/Function.h"
+#include "llvm/IR/GlobalValue.h"
 #include "llvm/IR/InstrTypes.h"
 #include "llvm/IR/Module.h"
 
-#include <set>
+#include <cstdint>
+
+// what an MPI function means for the message overtaking analysis
+enum class MPIFunctionKind : uint8_t {
+  NOT_MPI,
+  // may result in a conflict for msg overtaking (blocking and nonblocking)
+  SEND,
+  RECV,
+  SENDRECV,
+  // will end the conflicting timeframe (like a barrier)
+  SYNC,
+  // will end the conflicting timeframe once completed (like Ibarrier)
+  NONBLOCKING_SYNC,
+  // completes a nonblocking operation, no implications for msg overtaking
+  COMPLETION,
+  // all other MPI functions (e.g. MPI_Comm_rank)
+  OTHER
+};
+
+// the MPI functions known to the analysis
+enum class MPIFunctionId : uint8_t {
+  Init,
+  Finalize,
+
+  Send,
+  Bsend,
+  Ssend,
+  Rsend,
+  Isend,
+  Ibsend,
+  Issend,
+  Irsend,
+
+  Sendrecv,
+
+  Recv,
+  Irecv,
+
+  Test,
+  Wait,
+  Waitall,
+  Buffer_detach,
+
+  Barrier,
+  Allreduce,
+  Ibarrier,
+  Iallreduce,
+
+  // other MPI function or no MPI function at all
+  Unknown
+};
+
+// the arguments of the MPI functions that are of interest for the analysis
+enum class MPIArgument : uint8_t {
+  Buffer,
+  Count,
+  Type,
+  // src or dest
+  Peer,
+  Tag,
+  Comm,
+  Request,
+  NUM_ARGUMENTS
+};
 
-// global:
-// will be init and destroyed in the Passes runOnModule function (equivalent to
-// main)
-extern struct mpi_functions *mpi_func;
+struct MPIFunctionInfo {
+  MPIFunctionId id = MPIFunctionId::Unknown;
+  MPIFunctionKind kind = MPIFunctionKind::NOT_MPI;
+};
 
 struct mpi_functions {
   llvm::Function *mpi_init = nullptr;
@@ -56,22 +121,53 @@ struct mpi_functions {
   llvm::Function *mpi_Ibarrier = nullptr;
   llvm::Function *mpi_Iallreduce = nullptr;
 
-  std::set<llvm::Function *>
-      conflicting_functions; // may result in a conflict for msg overtaking
-  std::set<llvm::Function *>
-      sync_functions; // will end the conflicting timeframe (like a barrier)
-  std::set<llvm::Function *>
-      unimportant_functions; // no implications for msg overtaking
+  // id and kind of all MPI functions of the module
+  // functions not in this map are no MPI functions
+  llvm::DenseMap<const llvm::Function *, MPIFunctionInfo> function_info;
 };
 
 struct mpi_functions *get_used_mpi_functions(llvm::Module &M);
 
 bool is_mpi_used(struct mpi_functions *mpi_func);
-
-bool is_mpi_call(llvm::CallBase *call);
-bool is_mpi_function(llvm::Function *f);
-
-bool is_send_function(llvm::Function *f);
-bool is_recv_function(llvm::Function *f);
+// true if any point-to-point or collective communication is used, even
+// without MPI_Init (e.g. in a library)
+bool is_mpi_communication_used(struct mpi_functions *mpi_func);
+
+// all queries are a single lookup in the MPI functions of the module and may
+// be called with nullptr (indirect calls), which is no MPI function
+MPIFunctionInfo get_mpi_function_info(const struct mpi_functions &mpi_func,
+                                      const llvm::Function *f);
+MPIFunctionKind get_mpi_function_kind(const struct mpi_functions &mpi_func,
+                                      const llvm::Function *f);
+MPIFunctionId get_mpi_function_id(const struct mpi_functions &mpi_func,
+                                  const llvm::Function *f);
+// for functions only known by the GUID of their name (e.g. in the ThinLTO
+// combined summary index), only the functions known to the analysis are found
+MPIFunctionKind get_mpi_function_kind_by_guid(llvm::GlobalValue::GUID guid);
+
+bool is_mpi_call(const struct mpi_functions &mpi_func, llvm::CallBase *call);
+bool is_mpi_function(const struct mpi_functions &mpi_func, llvm::Function *f);
+
+// the given argument of the call
+// is_send selects the sending or receiving part (only relevant for
+// MPI_Sendrecv, for other functions it has to match the function)
+llvm::Value *get_mpi_argument(const struct mpi_functions &mpi_func,
+                              llvm::CallBase *mpi_call, MPIArgument arg,
+                              bool is_send);
+// true if the function has the given argument (in the given part)
+bool has_mpi_argument(const struct mpi_functions &mpi_func,
+                      const llvm::Function *f, MPIArgument arg, bool is_send);
+
+inline bool is_conflicting_kind(MPIFunctionKind kind) {
+  return kind == MPIFunctionKind::SEND || kind == MPIFunctionKind::RECV ||
+         kind == MPIFunctionKind::SENDRECV;
+}
+inline bool is_sync_kind(MPIFunctionKind kind) {
+  return kind == MPIFunctionKind::SYNC ||
+         kind == MPIFunctionKind::NONBLOCKING_SYNC;
+}
+
+bool is_send_function(const struct mpi_functions &mpi_func, llvm::Function *f);
+bool is_recv_function(const struct mpi_functions &mpi_func, llvm::Function *f);
 
 #endif /* MACH_MPI_FUNCTIONS_H_ */
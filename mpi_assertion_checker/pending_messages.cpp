@@ -0,0 +1,663 @@
+/*
+  Copyright 2020 Tim Jammer
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+       http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.
+ */
+
+#include "pending_messages.h"
+#include "analysis_context.h"
+#include "conflict_detection.h"
+#include "mpi_functions.h"
+
+#include "llvm/ADT/BitVector.h"
+#include "llvm/ADT/Statistic.h"
+#include "llvm/IR/Function.h"
+#include "llvm/IR/Instructions.h"
+
+#include <algorithm>
+#include <deque>
+
+#include "debug.h"
+
+using namespace llvm;
+
+#define DEBUG_TYPE "mpi-assertion-checker"
+
+STATISTIC(NumPendingStates, "States of analyzed calls in the dataflow");
+STATISTIC(NumSegmentsVisited, "Segments processed until the fixpoint");
+STATISTIC(NumEpochGraphs, "Epoch graphs built for the sync communicators");
+STATISTIC(NumCallsNotReaching,
+          "Analyzed calls ended by a sync point before reaching any call");
+
+// bounds the memory of the epoch graphs, the sync points on other
+// communicators are ignored (which is safe, the messages are pending longer)
+static const unsigned max_epoch_graphs = 16;
+
+// only calls that change the pending calls or may be reached by them matter
+static bool is_event(const AnalysisContext &ctx, CallBase *call) {
+  const auto kind =
+      get_mpi_function_kind(*ctx.mpi_func, call->getCalledFunction());
+  if (kind == MPIFunctionKind::NOT_MPI) {
+    const auto properties =
+        ctx.function_metadata->get_properties(call->getCalledFunction());
+    return properties.may_conflict() || properties.will_sync() ||
+           properties.is_unknown();
+  }
+  return is_sync_kind(kind) || is_conflicting_kind(kind) ||
+         kind == MPIFunctionKind::COMPLETION;
+}
+
+// the point where the code continues when the called function returns
+// an invoke is the terminator of its block, it continues at the normal
+// destination
+static Instruction *get_return_site(CallBase *call) {
+  if (auto *invoke = dyn_cast<InvokeInst>(call)) {
+    return invoke->getNormalDest()->getFirstNonPHI();
+  }
+  assert(call->getNextNode() != nullptr);
+  return call->getNextNode();
+}
+
+PendingMessages::PendingMessages(const AnalysisContext &ctx, Module &M)
+    : ctx(ctx) {
+  const auto *block_numbering = ctx.block_numbering.get();
+
+  // index of the first segment of each function
+  DenseMap<Function *, unsigned> offsets;
+  unsigned num_segments = 0;
+  for (auto &F : M) {
+    offsets[&F] = num_segments;
+    num_segments += block_numbering->get_num_entries(&F);
+  }
+  segments.resize(num_segments);
+
+  auto get_segment = [&](Instruction *entry) {
+    return offsets[entry->getFunction()] + block_numbering->get_index(entry);
+  };
+
+  for (auto &F : M) {
+    for (auto &BB : F) {
+      unsigned current = get_segment(BB.getFirstNonPHI());
+      segments[current].events_begin = events.size();
+
+      for (auto *inst = BB.getFirstNonPHI(); inst != nullptr;
+           inst = inst->getNextNode()) {
+        if (inst != BB.getFirstNonPHI() && block_numbering->is_entry(inst)) {
+          // point after a call: the code continues in the next segment
+          unsigned next = get_segment(inst);
+          segments[current].events_end = events.size();
+          segments[current].successors.push_back(next);
+          current = next;
+          segments[current].events_begin = events.size();
+        }
+
+        if (isa<UnreachableInst>(inst)) {
+          // no successors
+          break;
+        }
+
+        if (auto *call = dyn_cast<CallBase>(inst)) {
+          if (is_event(ctx, call)) {
+            events.push_back(call);
+            if (get_mpi_function_kind(*ctx.mpi_func,
+                                      call->getCalledFunction()) ==
+                MPIFunctionKind::NONBLOCKING_SYNC) {
+              ibarriers.push_back(
+                  std::make_pair(call, get_corresponding_wait(ctx, call)));
+            }
+          }
+        }
+
+        if (inst->isTerminator()) {
+          auto &segment = segments[current];
+          if (auto *br = dyn_cast<BranchInst>(inst)) {
+            if (br->isConditional()) {
+              segment.condition = br->getCondition();
+            }
+          }
+          for (unsigned int i = 0; i < inst->getNumSuccessors(); ++i) {
+            segment.successors.push_back(
+                get_segment(inst->getSuccessor(i)->getFirstNonPHI()));
+          }
+          if (isa<ReturnInst>(inst)) {
+            if (!F.hasLocalLinkage()) {
+              segment.external_return = &F;
+            }
+            // continue after all call sites
+            for (auto *user : F.users()) {
+              if (auto *where_returns = dyn_cast<CallBase>(user)) {
+                if (where_returns->getCalledFunction() == &F) {
+                  segment.successors.push_back(
+                      get_segment(get_return_site(where_returns)));
+                }
+              }
+            }
+          }
+        }
+      }
+      segments[current].events_end = events.size();
+    }
+  }
+
+  for (unsigned int e = 0; e < events.size(); ++e) {
+    event_index[events[e]] = e;
+  }
+
+  epoch_graphs[nullptr] = std::make_unique<EpochGraph>(*this, nullptr);
+  for (auto *call : events) {
+    if (epoch_graphs.size() > max_epoch_graphs) {
+      break;
+    }
+    if (get_mpi_function_kind(*ctx.mpi_func, call->getCalledFunction()) ==
+            MPIFunctionKind::SYNC &&
+        call->getCalledFunction() != ctx.mpi_func->mpi_finalize) {
+      auto *comm = get_communicator(*ctx.mpi_func, call);
+      if (epoch_graphs.find(comm) == epoch_graphs.end()) {
+        epoch_graphs[comm] = std::make_unique<EpochGraph>(*this, comm);
+      }
+    }
+  }
+  NumEpochGraphs += epoch_graphs.size();
+}
+
+// same classification as in Solver::set_up_effects
+bool PendingMessages::is_read(CallBase *call) const {
+  const auto kind =
+      get_mpi_function_kind(*ctx.mpi_func, call->getCalledFunction());
+  if (kind == MPIFunctionKind::NOT_MPI) {
+    const auto properties =
+        ctx.function_metadata->get_properties(call->getCalledFunction());
+    return properties.may_conflict() ||
+           (!properties.will_sync() && properties.is_unknown());
+  }
+  return is_conflicting_kind(kind);
+}
+
+bool PendingMessages::is_sync(CallBase *call, Value *comm) const {
+  const auto kind =
+      get_mpi_function_kind(*ctx.mpi_func, call->getCalledFunction());
+  if (kind == MPIFunctionKind::NOT_MPI) {
+    const auto properties =
+        ctx.function_metadata->get_properties(call->getCalledFunction());
+    return !properties.may_conflict() && properties.will_sync();
+  }
+  if (kind == MPIFunctionKind::SYNC) {
+    if (call->getCalledFunction() == ctx.mpi_func->mpi_finalize) {
+      return true;
+    }
+    return comm != nullptr && get_communicator(*ctx.mpi_func, call) == comm;
+  }
+  return false;
+}
+
+// the segments are split into epochs at the sync points, the last epoch of
+// a segment continues in the first epochs of the successors
+PendingMessages::EpochGraph::EpochGraph(const PendingMessages &graph,
+                                        Value *comm)
+    : reaches_after(graph.events.size()) {
+  const auto &segments = graph.segments;
+
+  struct Epoch {
+    unsigned events_begin;
+    unsigned events_end;
+    // not set for the epochs ending at a sync point
+    int segment;
+    std::vector<unsigned> successors;
+    std::vector<unsigned> predecessors;
+    // contains a call that may be reached or continues in such an epoch
+    bool may_reach = false;
+  };
+  std::vector<Epoch> epochs;
+  std::vector<unsigned> first_epoch(segments.size());
+
+  for (unsigned int s = 0; s < segments.size(); ++s) {
+    first_epoch[s] = epochs.size();
+    unsigned begin = segments[s].events_begin;
+    for (unsigned e = begin; e < segments[s].events_end; ++e) {
+      if (graph.is_sync(graph.events[e], comm)) {
+        epochs.push_back({begin, e + 1, -1, {}, {}});
+        begin = e + 1;
+      }
+    }
+    epochs.push_back({begin, segments[s].events_end, (int)s, {}, {}});
+  }
+
+  std::vector<unsigned> worklist;
+  for (unsigned int k = 0; k < epochs.size(); ++k) {
+    auto &epoch = epochs[k];
+    if (epoch.segment != -1) {
+      for (auto succ : segments[epoch.segment].successors) {
+        epoch.successors.push_back(first_epoch[succ]);
+        epochs[first_epoch[succ]].predecessors.push_back(k);
+      }
+      epoch.may_reach = segments[epoch.segment].external_return != nullptr;
+    }
+    for (unsigned e = epoch.events_begin; e < epoch.events_end; ++e) {
+      epoch.may_reach |= graph.is_read(graph.events[e]);
+    }
+    if (epoch.may_reach) {
+      worklist.push_back(k);
+    }
+  }
+  while (!worklist.empty()) {
+    unsigned k = worklist.back();
+    worklist.pop_back();
+    for (auto pred : epochs[k].predecessors) {
+      if (!epochs[pred].may_reach) {
+        epochs[pred].may_reach = true;
+        worklist.push_back(pred);
+      }
+    }
+  }
+
+  // from the end of each epoch back to the event of the pending call
+  for (unsigned int k = 0; k < epochs.size(); ++k) {
+    const auto &epoch = epochs[k];
+    bool may_reach = false;
+    if (epoch.segment != -1) {
+      may_reach =
+          segments[epoch.segment].external_return != nullptr ||
+          std::any_of(epoch.successors.begin(), epoch.successors.end(),
+                      [&](unsigned succ) { return epochs[succ].may_reach; });
+    }
+    for (unsigned e = epoch.events_end; e > epoch.events_begin; --e) {
+      if (e == epoch.events_end && epoch.segment == -1) {
+        // the sync point: afterwards the next epoch of the segment
+        if (epochs[k + 1].may_reach) {
+          reaches_after.set(e - 1);
+        }
+        continue;
+      }
+      if (may_reach) {
+        reaches_after.set(e - 1);
+      }
+      may_reach |= graph.is_read(graph.events[e - 1]);
+    }
+  }
+}
+
+bool PendingMessages::may_reach_anything(const AnalyzedCall &call) const {
+  auto event = event_index.find(call.call);
+  if (!call.scope_endings.empty() || event == event_index.end()) {
+    // the messages within the scope are not ended by sync points
+    return true;
+  }
+  auto graph = epoch_graphs.find(call.comm);
+  if (graph == epoch_graphs.end()) {
+    graph = epoch_graphs.find(nullptr);
+  }
+  return graph->second->may_reach_after(event->second);
+}
+
+class PendingMessages::Solver {
+public:
+  Solver(const PendingMessages &graph, const std::vector<AnalyzedCall> &calls);
+
+  std::vector<ReachabilitySummary> solve();
+
+private:
+  enum ReadKind { NO_READ, READ_POTENTIAL, READ_CONFLICTING };
+
+  // effect of one event on the pending states
+  struct Effect {
+    ReadKind read = NO_READ;
+    // states ended by a sync point
+    const BitVector *kill = nullptr;
+    // state transitions (e.g. end of scope)
+    std::vector<std::pair<unsigned, unsigned>> moves;
+    // initial state of an analyzed call
+    int gen = -1;
+  };
+
+  // adds a state of call
+  unsigned add_state(unsigned call);
+  void set_up_effects();
+  // applies the event to pending
+  // if results is given, the event is recorded as reachable from all
+  // pending calls
+  void transfer(unsigned event, BitVector &pending,
+                std::vector<ReachabilitySummary> *results) const;
+
+  const PendingMessages &graph;
+  const std::vector<AnalyzedCall> &calls;
+
+  // analyzed call of each state
+  std::vector<unsigned> state_call;
+  // per call: state before the end of the scope (-1 if none), state after
+  std::vector<int> open_state;
+  std::vector<unsigned> ended_state;
+  // per Ibarrier: the call and its state while the Ibarrier is active
+  std::vector<std::vector<std::pair<unsigned, unsigned>>> ibarrier_states;
+
+  std::vector<Effect> effects;
+  // per guarding condition: the states that do not follow the true/false
+  // successor
+  DenseMap<Value *, std::pair<BitVector, BitVector>> blocked;
+  // the sync masks, pointers must stay valid
+  std::deque<BitVector> masks;
+};
+
+unsigned PendingMessages::Solver::add_state(unsigned call) {
+  state_call.push_back(call);
+  return state_call.size() - 1;
+}
+
+PendingMessages::Solver::Solver(const PendingMessages &graph,
+                                const std::vector<AnalyzedCall> &calls)
+    : graph(graph), calls(calls), open_state(calls.size(), -1),
+      ended_state(calls.size()), ibarrier_states(graph.ibarriers.size()) {
+
+  for (unsigned int i = 0; i < calls.size(); ++i) {
+    if (!calls[i].scope_endings.empty()) {
+      open_state[i] = add_state(i);
+    }
+    ended_state[i] = add_state(i);
+    for (unsigned int j = 0; j < graph.ibarriers.size(); ++j) {
+      if (get_communicator(*graph.ctx.mpi_func, graph.ibarriers[j].first) ==
+          calls[i].comm) {
+        ibarrier_states[j].push_back(std::make_pair(i, add_state(i)));
+      }
+    }
+  }
+  NumPendingStates += state_call.size();
+
+  // the guard of a call restricts the paths of all of its states
+  for (unsigned int s = 0; s < state_call.size(); ++s) {
+    const auto &call = calls[state_call[s]];
+    if (call.guard != nullptr) {
+      auto &guard_masks = blocked[call.guard];
+      guard_masks.first.resize(state_call.size());
+      guard_masks.second.resize(state_call.size());
+      if (call.way_to_take) {
+        guard_masks.second.set(s);
+      } else {
+        guard_masks.first.set(s);
+      }
+    }
+  }
+
+  set_up_effects();
+}
+
+void PendingMessages::Solver::set_up_effects() {
+  const unsigned num_states = state_call.size();
+  const auto &mpi_func = *graph.ctx.mpi_func;
+
+  DenseMap<CallBase *, unsigned> analyzed;
+  for (unsigned int i = 0; i < calls.size(); ++i) {
+    analyzed[calls[i].call] = i;
+  }
+  DenseMap<CallBase *, unsigned> ibarrier_index;
+  // the Ibarriers and calls whose scope is ended by a completion call
+  DenseMap<CallBase *, std::vector<unsigned>> completed_ibarriers;
+  DenseMap<CallBase *, std::vector<unsigned>> ended_scopes;
+  for (unsigned int j = 0; j < graph.ibarriers.size(); ++j) {
+    ibarrier_index[graph.ibarriers[j].first] = j;
+    for (auto *wait : graph.ibarriers[j].second) {
+      completed_ibarriers[wait].push_back(j);
+    }
+  }
+  for (unsigned int i = 0; i < calls.size(); ++i) {
+    for (auto *ending : calls[i].scope_endings) {
+      ended_scopes[ending].push_back(i);
+    }
+  }
+
+  // states after the end of the scope: they are ended by a sync point
+  masks.emplace_back(num_states);
+  BitVector &after_scope = masks.back();
+  DenseMap<Value *, BitVector *> after_scope_per_comm;
+  for (unsigned int s = 0; s < num_states; ++s) {
+    unsigned call = state_call[s];
+    if (open_state[call] != (int)s) {
+      after_scope.set(s);
+      auto *&comm_mask = after_scope_per_comm[calls[call].comm];
+      if (comm_mask == nullptr) {
+        masks.emplace_back(num_states);
+        comm_mask = &masks.back();
+      }
+      comm_mask->set(s);
+    }
+  }
+  masks.emplace_back(num_states, true);
+  const BitVector &all_states = masks.back();
+
+  effects.resize(graph.events.size());
+  for (unsigned int e = 0; e < graph.events.size(); ++e) {
+    auto *call = graph.events[e];
+    auto &effect = effects[e];
+    const auto kind =
+        get_mpi_function_kind(mpi_func, call->getCalledFunction());
+
+    if (kind == MPIFunctionKind::NOT_MPI) {
+      const auto properties = graph.ctx.function_metadata->get_properties(
+          call->getCalledFunction());
+      if (properties.may_conflict()) {
+        effect.read = READ_CONFLICTING;
+      } else if (properties.will_sync()) {
+        // sync point, regardless of the scope
+        effect.kill = &all_states;
+      } else if (properties.is_unknown()) {
+        // assume conflict
+        effect.read = READ_CONFLICTING;
+      }
+      // analyzed as well: stands for the messages still pending when it
+      // returns
+      auto search = analyzed.find(call);
+      if (search != analyzed.end()) {
+        effect.gen = ended_state[search->second];
+      }
+
+    } else if (is_conflicting_kind(kind)) {
+      effect.read = READ_POTENTIAL;
+      auto search = analyzed.find(call);
+      if (search != analyzed.end()) {
+        unsigned i = search->second;
+        effect.gen = open_state[i] != -1 ? open_state[i] : ended_state[i];
+      }
+
+    } else if (kind == MPIFunctionKind::NONBLOCKING_SYNC) {
+      // the rest of the code belongs to the Ibarrier, until it is completed
+      // if another Ibarrier is already active, it is ignored
+      unsigned j = ibarrier_index[call];
+      for (auto &call_state : ibarrier_states[j]) {
+        effect.moves.push_back(
+            std::make_pair(ended_state[call_state.first], call_state.second));
+      }
+
+    } else if (kind == MPIFunctionKind::SYNC) {
+      if (call->getCalledFunction() == mpi_func.mpi_finalize) {
+        // no mpi beyond this
+        effect.kill = &after_scope;
+      } else {
+        // else: could not prove that barrier is in the same communicator
+        auto search =
+            after_scope_per_comm.find(get_communicator(mpi_func, call));
+        if (search != after_scope_per_comm.end()) {
+          effect.kill = search->second;
+        }
+      }
+
+    } else if (kind == MPIFunctionKind::COMPLETION) {
+      // completed Ibarriers
+      BitVector completed(num_states);
+      for (auto j : completed_ibarriers.lookup(call)) {
+        for (auto &call_state : ibarrier_states[j]) {
+          completed.set(call_state.second);
+        }
+      }
+      if (completed.any()) {
+        masks.push_back(std::move(completed));
+        effect.kill = &masks.back();
+      }
+      // end of scope
+      for (auto i : ended_scopes.lookup(call)) {
+        assert(open_state[i] != -1);
+        effect.moves.push_back(std::make_pair(open_state[i], ended_state[i]));
+      }
+    }
+  }
+}
+
+void PendingMessages::Solver::transfer(
+    unsigned event, BitVector &pending,
+    std::vector<ReachabilitySummary> *results) const {
+  const auto &effect = effects[event];
+
+  if (results != nullptr && effect.read != NO_READ) {
+    auto *call = graph.events[event];
+    for (unsigned s : pending.set_bits()) {
+      auto &result = (*results)[state_call[s]];
+      if (effect.read == READ_POTENTIAL) {
+        result.potential_conflicts.insert(call);
+      } else {
+        result.conflicting_calls.insert(call);
+      }
+    }
+  }
+
+  if (effect.kill != nullptr) {
+    pending.reset(*effect.kill);
+  }
+  for (auto &move : effect.moves) {
+    if (pending.test(move.first)) {
+      pending.reset(move.first);
+      pending.set(move.second);
+    }
+  }
+  if (effect.gen != -1) {
+    pending.set(effect.gen);
+  }
+}
+
+std::vector<ReachabilitySummary> PendingMessages::Solver::solve() {
+  const unsigned num_states = state_call.size();
+  const auto &segments = graph.segments;
+
+  // pending states at the start of each segment
+  // only allocated for the segments that are reached
+  std::vector<BitVector> pending_in(segments.size());
+  std::vector<unsigned> worklist;
+  BitVector in_worklist(segments.size());
+
+  // the analyzed calls are the only source of pending states
+  BitVector has_gen(segments.size());
+  for (unsigned int s = 0; s < segments.size(); ++s) {
+    for (unsigned e = segments[s].events_begin; e < segments[s].events_end;
+         ++e) {
+      if (effects[e].gen != -1) {
+        has_gen.set(s);
+        worklist.push_back(s);
+        in_worklist.set(s);
+        break;
+      }
+    }
+  }
+
+  BitVector pending;
+  BitVector out;
+  while (!worklist.empty()) {
+    unsigned s = worklist.back();
+    worklist.pop_back();
+    in_worklist.reset(s);
+    ++NumSegmentsVisited;
+
+    const auto &segment = segments[s];
+    pending = pending_in[s];
+    pending.resize(num_states);
+    for (unsigned e = segment.events_begin; e < segment.events_end; ++e) {
+      transfer(e, pending, nullptr);
+    }
+    if (pending.none()) {
+      continue;
+    }
+
+    auto guard_masks = blocked.end();
+    if (segment.condition != nullptr) {
+      guard_masks = blocked.find(segment.condition);
+    }
+    for (unsigned int i = 0; i < segment.successors.size(); ++i) {
+      out = pending;
+      if (guard_masks != blocked.end() && i < 2) {
+        // only the successor taken by the guarded calls
+        out.reset(i == 0 ? guard_masks->second.first
+                         : guard_masks->second.second);
+      }
+
+      unsigned succ = segment.successors[i];
+      auto &succ_in = pending_in[succ];
+      if (succ_in.empty()) {
+        succ_in.resize(num_states);
+      }
+      // test: if out has states not yet in succ_in
+      if (out.test(succ_in)) {
+        succ_in |= out;
+        if (!in_worklist.test(succ)) {
+          worklist.push_back(succ);
+          in_worklist.set(succ);
+        }
+      }
+    }
+  }
+
+  // fixpoint reached: collect the calls reachable from the pending calls
+  std::vector<ReachabilitySummary> results(calls.size());
+  for (unsigned int s = 0; s < segments.size(); ++s) {
+    if (pending_in[s].empty() && !has_gen.test(s)) {
+      // not reached
+      continue;
+    }
+    const auto &segment = segments[s];
+    pending = pending_in[s];
+    pending.resize(num_states);
+    for (unsigned e = segment.events_begin; e < segment.events_end; ++e) {
+      transfer(e, pending, &results);
+    }
+    if (segment.external_return != nullptr) {
+      for (unsigned state : pending.set_bits()) {
+        results[state_call[state]].pending_at_return.insert(
+            segment.external_return);
+      }
+    }
+  }
+
+  Debug(errs() << "Pending messages: " << num_states << " states of "
+               << calls.size() << " calls\n";);
+
+  return results;
+}
+
+std::vector<ReachabilitySummary>
+PendingMessages::solve(const std::vector<AnalyzedCall> &calls) const {
+  // the calls that reach nothing keep an empty summary
+  std::vector<AnalyzedCall> reaching;
+  std::vector<unsigned> index;
+  for (unsigned int i = 0; i < calls.size(); ++i) {
+    if (may_reach_anything(calls[i])) {
+      reaching.push_back(calls[i]);
+      index.push_back(i);
+    }
+  }
+  NumCallsNotReaching += calls.size() - reaching.size();
+
+  std::vector<ReachabilitySummary> results(calls.size());
+  if (reaching.empty()) {
+    return results;
+  }
+  Solver solver(*this, reaching);
+  auto reaching_results = solver.solve();
+  for (unsigned int i = 0; i < index.size(); ++i) {
+    results[index[i]] = std::move(reaching_results[i]);
+  }
+  return results;
+}
@@ -0,0 +1,139 @@
+/*
+  Copyright 2020 Tim Jammer
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+       http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.
+ */
+
+#ifndef MACH_PENDING_MESSAGES_H_
+#define MACH_PENDING_MESSAGES_H_
+
+#include "llvm/ADT/BitVector.h"
+#include "llvm/ADT/DenseMap.h"
+#include "llvm/IR/InstrTypes.h"
+#include "llvm/IR/Instruction.h"
+#include "llvm/IR/Module.h"
+#include "llvm/IR/Value.h"
+
+#include "reachability_summaries.h"
+
+#include <memory>
+#include <utility>
+#include <vector>
+
+struct AnalysisContext;
+
+// the parts of an analyzed call the analysis depends on
+struct AnalyzedCall {
+  llvm::CallBase *call;
+  // for calls of functions defined in other modules: the communicator assumed
+  // for the messages pending when it returns (nullptr if unknown)
+  llvm::Value *comm;
+  // guarding condition of the call (if any)
+  llvm::Value *guard;
+  bool way_to_take;
+  // if scope ending.empty: normal send without a scope
+  std::vector<llvm::CallBase *> scope_endings;
+};
+
+// forward dataflow analysis of the messages, that may still be pending
+// (not yet ordered by a sync point)
+// the lattice is the set of pending analyzed calls, where each call may be
+// pending in several states:
+// - its scope has not ended yet (e.g. Isend before the Wait)
+// - its scope has ended
+// - its scope has ended and an Ibarrier (or Iallreduce) on the same
+//   communicator is active
+// the states are encoded as bits, an analyzed call generates its state after
+// the call, sync points kill the states (if the scope has ended and the
+// communicator is the same)
+// whenever an MPI call (or a call to a function that may conflict) is reached,
+// it is reachable from all pending calls
+// calls that cannot reach anything before their messages are ordered by a
+// sync point (e.g. a send followed by a barrier) are found on the epoch graph
+// of their communicator and left out of the dataflow
+//
+// the nodes of the graph are the entry points of the BlockNumbering: the
+// code from one entry point up to the next one (or the end of the block)
+// returning from a function leads to the points after all its call sites
+// (the calls still pending when returning from a function, that may be called
+// from other modules, are marked)
+// calls of functions defined in other modules may be analyzed as well, they
+// stand for the messages still pending when the called function returns
+class PendingMessages {
+public:
+  // function_metadata, block_numbering and request_completions of ctx need to
+  // be set up beforehand
+  PendingMessages(const AnalysisContext &ctx, llvm::Module &M);
+  ~PendingMessages(){};
+
+  // everything reachable from each of the calls until a sync point
+  // does not use the function analyses and does not modify this, so it may
+  // be used for different calls concurrently (the calls are independent
+  // from each other)
+  std::vector<ReachabilitySummary>
+  solve(const std::vector<AnalyzedCall> &calls) const;
+
+private:
+  struct Segment {
+    // calls within the segment, that may change the pending calls or are
+    // reachable by them (index into events)
+    unsigned events_begin = 0;
+    unsigned events_end = 0;
+    // condition of the branch at the end of the segment (if any)
+    // successors[0] is taken if true, successors[1] if false
+    llvm::Value *condition = nullptr;
+    std::vector<unsigned> successors;
+    // the function it returns from, if it may be called from other modules
+    llvm::Function *external_return = nullptr;
+  };
+
+  // state of the analysis for one set of calls
+  class Solver;
+
+  // the epochs between the sync points on one communicator
+  class EpochGraph {
+  public:
+    // comm: the communicator of the ended messages, nullptr stands for
+    // messages only ended by MPI_Finalize and calls of functions that sync
+    EpochGraph(const PendingMessages &graph, llvm::Value *comm);
+
+    // whether a message of comm, that is pending after the event, may reach
+    // any event or return into another module before a sync point
+    bool may_reach_after(unsigned event) const {
+      return reaches_after.test(event);
+    }
+
+  private:
+    llvm::BitVector reaches_after;
+  };
+
+  // whether the event may be reached by pending calls (as in the Solver)
+  bool is_read(llvm::CallBase *call) const;
+  // whether the event ends the pending messages of comm after their scope
+  bool is_sync(llvm::CallBase *call, llvm::Value *comm) const;
+  // false if the call cannot reach anything, so the dataflow is not needed
+  bool may_reach_anything(const AnalyzedCall &call) const;
+
+  const AnalysisContext &ctx;
+  std::vector<Segment> segments;
+  std::vector<llvm::CallBase *> events;
+  llvm::DenseMap<llvm::CallBase *, unsigned> event_index;
+  // for the communicators of the sync points (a bounded number of them, for
+  // the others the epochs of nullptr are used)
+  llvm::DenseMap<llvm::Value *, std::unique_ptr<EpochGraph>> epoch_graphs;
+  // Ibarrier and Iallreduce calls and the calls completing them
+  std::vector<std::pair<llvm::CallBase *, std::vector<llvm::CallBase *>>>
+      ibarriers;
+};
+
+#endif /* MACH_PENDING_MESSAGES_H_ */
@@ -0,0 +1,35 @@
+/*
+  Copyright 2020 Tim Jammer
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+       http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.
+ */
+
+#ifndef MACH_REACHABILITY_SUMMARIES_H_
+#define MACH_REACHABILITY_SUMMARIES_H_
+
+#include "llvm/IR/InstrTypes.h"
+
+#include <set>
+
+// everything that can be reached from one analyzed call until a sync point
+struct ReachabilitySummary {
+  // MPI calls that may conflict (still need to be checked in detail)
+  std::set<llvm::CallBase *> potential_conflicts;
+  // calls to user functions that may conflict or are unknown
+  std::set<llvm::CallBase *> conflicting_calls;
+  // functions, that may be called from other modules and may return while
+  // the call is still pending
+  std::set<llvm::Function *> pending_at_return;
+};
+
+#endif /* MACH_REACHABILITY_SUMMARIES_H_ */
@@ -0,0 +1,111 @@
+/*
+  Copyright 2020 Tim Jammer
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+       http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.
+ */
+
+#include "request_completions.h"
+#include "mpi_functions.h"
+
+#include "llvm/IR/Constants.h"
+#include "llvm/IR/Instructions.h"
+
+using namespace llvm;
+
+// all users of F, that call it
+static std::vector<CallBase *> get_calls_of(Function *F) {
+  std::vector<CallBase *> result;
+  if (F == nullptr) {
+    return result;
+  }
+  for (auto *user : F->users()) {
+    if (auto *call = dyn_cast<CallBase>(user)) {
+      if (call->getCalledFunction() == F) {
+        result.push_back(call);
+      }
+    }
+  }
+  return result;
+}
+
+RequestCompletions::RequestCompletions(const struct mpi_functions &mpi_func,
+                                       Module &M) {
+  finalize_calls = get_calls_of(mpi_func.mpi_finalize);
+  buffer_detach_calls = get_calls_of(mpi_func.mpi_buffer_detach);
+
+  for (auto *call : get_calls_of(mpi_func.mpi_wait)) {
+    assert(call->getNumArgOperands() == 2);
+    insert_completion(call->getArgOperand(0), 1, call);
+  }
+
+  for (auto *call : get_calls_of(mpi_func.mpi_waitall)) {
+    assert(call->getNumArgOperands() == 3);
+    if (auto *count = dyn_cast<ConstantInt>(call->getArgOperand(0))) {
+      insert_completion(call->getArgOperand(1), count->getSExtValue(), call);
+    }
+    // else: could not prove which requests are completed
+  }
+}
+
+bool RequestCompletions::get_request_slot(Value *ptr, RequestSlot &slot) {
+  if (isa<AllocaInst>(ptr)) {
+    slot = std::make_pair(ptr, 0);
+    return true;
+  }
+
+  // element of a request array
+  // ofc at some point of pointer arithmetic, we cannot follow it
+  if (auto *gep = dyn_cast<GetElementPtrInst>(ptr)) {
+    if (isa<AllocaInst>(gep->getPointerOperand()) &&
+        gep->getNumIndices() == 2 && gep->hasAllConstantIndices()) {
+      auto *index_it = gep->idx_begin();
+      ConstantInt *i0 = cast<ConstantInt>(&*index_it);
+      index_it++;
+      ConstantInt *index_in_array = cast<ConstantInt>(&*index_it);
+      if (i0->isZero()) {
+        slot = std::make_pair(gep->getPointerOperand(),
+                              index_in_array->getSExtValue());
+        return true;
+      }
+    }
+  }
+
+  return false;
+}
+
+// call completes count requests starting at requests
+void RequestCompletions::insert_completion(Value *requests, int64_t count,
+                                           CallBase *call) {
+  RequestSlot begin;
+  if (!get_request_slot(requests, begin)) {
+    return;
+  }
+  for (int64_t i = 0; i < count; ++i) {
+    completions[std::make_pair(begin.first, begin.second + i)].push_back(
+        call);
+  }
+}
+
+std::vector<CallBase *>
+RequestCompletions::get_completions(Value *request) const {
+  RequestSlot slot;
+  if (!get_request_slot(request, slot)) {
+    return {};
+  }
+  auto search = completions.find(slot);
+  if (search != completions.end()) {
+    return search->second;
+  } else {
+    return {};
+  }
+}
@@ -0,0 +1,67 @@
+/*
+  Copyright 2020 Tim Jammer
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+       http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.
+ */
+
+#ifndef MACH_REQUEST_COMPLETIONS_H_
+#define MACH_REQUEST_COMPLETIONS_H_
+
+#include "llvm/ADT/DenseMap.h"
+#include "llvm/IR/InstrTypes.h"
+#include "llvm/IR/Module.h"
+#include "llvm/IR/Value.h"
+
+#include "mpi_functions.h"
+
+#include <utility>
+#include <vector>
+
+// maps the storage of MPI requests to the calls that complete them
+// (MPI_Wait, MPI_Waitall), so that the scope of a nonblocking call can be
+// looked up without searching the users of the request every time
+// a storage slot is an alloca or an element of an alloca'd array with
+// constant index, other requests cannot be followed
+// MPI_Test is not considered, as it does not need to complete the request
+// built once, the lookup may be used from multiple threads
+class RequestCompletions {
+public:
+  RequestCompletions(const struct mpi_functions &mpi_func, llvm::Module &M);
+  ~RequestCompletions(){};
+
+  // the calls completing the request stored at the given pointer
+  std::vector<llvm::CallBase *> get_completions(llvm::Value *request) const;
+
+  const std::vector<llvm::CallBase *> &get_finalize_calls() const {
+    return finalize_calls;
+  }
+  const std::vector<llvm::CallBase *> &get_buffer_detach_calls() const {
+    return buffer_detach_calls;
+  }
+
+private:
+  // alloca and index in it
+  using RequestSlot = std::pair<llvm::Value *, int64_t>;
+
+  // false if ptr is not one of the supported storage slots
+  static bool get_request_slot(llvm::Value *ptr, RequestSlot &slot);
+
+  void insert_completion(llvm::Value *requests, int64_t count,
+                         llvm::CallBase *call);
+
+  llvm::DenseMap<RequestSlot, std::vector<llvm::CallBase *>> completions;
+  std::vector<llvm::CallBase *> finalize_calls;
+  std::vector<llvm::CallBase *> buffer_detach_calls;
+};
+
+#endif /* MACH_REQUEST_COMPLETIONS_H_ */
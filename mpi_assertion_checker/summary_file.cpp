@@ -0,0 +1,165 @@
+/*
+  Copyright 2020 Tim Jammer
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+       http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.
+ */
+
+#include "summary_file.h"
+#include "binary_stream.h"
+
+#include "llvm/Support/FileSystem.h"
+#include "llvm/Support/raw_ostream.h"
+
+using namespace llvm;
+
+const char *summary_file_extension = ".machsum";
+
+// "MACH" followed by the version of the format
+static const char summary_magic[] = {'M', 'A', 'C', 'H'};
+static const uint64_t summary_version = 1;
+
+// module flags
+static const uint64_t MODULE_CHECKED = 1 << 0;
+static const uint64_t MODULE_NO_ANY_TAG = 1 << 1;
+static const uint64_t MODULE_NO_ANY_SOURCE = 1 << 2;
+static const uint64_t MODULE_EXACT_LENGTH = 1 << 3;
+
+// message flags
+static const uint64_t MESSAGE_IS_SEND = 1 << 0;
+static const uint64_t MESSAGE_ESCAPES_SCOPE = 1 << 1;
+static const uint64_t MESSAGE_LOCAL_CONFLICT = 1 << 2;
+
+Error write_summary_file(const ModuleSummary &summary, StringRef path) {
+  std::error_code EC;
+  raw_fd_ostream os(path, EC, sys::fs::OF_None);
+  if (EC) {
+    return errorCodeToError(EC);
+  }
+
+  os.write(summary_magic, sizeof(summary_magic));
+  BinaryWriter writer(os);
+  writer.write_number(summary_version);
+  writer.write_string(summary.module_name);
+  writer.write_number((summary.is_checked ? MODULE_CHECKED : 0) |
+                      (summary.no_any_tag ? MODULE_NO_ANY_TAG : 0) |
+                      (summary.no_any_source ? MODULE_NO_ANY_SOURCE : 0) |
+                      (summary.exact_length ? MODULE_EXACT_LENGTH : 0));
+
+  writer.write_number(summary.functions.size());
+  for (const auto &function : summary.functions) {
+    writer.write_string(function.name);
+    writer.write_number(function.is_local);
+    writer.write_number(function.properties.flags);
+
+    writer.write_number(function.messages.size());
+    for (const auto &message : function.messages) {
+      writer.write_string(message.mpi_function);
+      writer.write_number(
+          (message.is_send ? MESSAGE_IS_SEND : 0) |
+          (message.escapes_scope ? MESSAGE_ESCAPES_SCOPE : 0) |
+          (message.has_local_conflict ? MESSAGE_LOCAL_CONFLICT : 0));
+      writer.write_string(message.comm);
+      writer.write_string(message.peer);
+      writer.write_string(message.tag);
+      writer.write_strings(message.pending_calls);
+      writer.write_strings(message.pending_at_return);
+    }
+
+    writer.write_number(function.syncs.size());
+    for (const auto &sync : function.syncs) {
+      writer.write_string(sync.mpi_function);
+      writer.write_string(sync.comm);
+    }
+
+    writer.write_strings(function.callees);
+    writer.write_strings(function.unknown_callees);
+
+    writer.write_number(function.external_calls.size());
+    for (const auto &call : function.external_calls) {
+      writer.write_string(call.callee);
+      writer.write_number(call.is_synced);
+      writer.write_strings(call.synced_comms);
+    }
+  }
+
+  os.close();
+  if (os.has_error()) {
+    EC = os.error();
+    os.clear_error();
+    return errorCodeToError(EC);
+  }
+  return Error::success();
+}
+
+Expected<ModuleSummary> read_summary(StringRef buffer) {
+  if (!buffer.startswith(StringRef(summary_magic, sizeof(summary_magic)))) {
+    return createStringError(inconvertibleErrorCode(),
+                             "not a communication summary");
+  }
+  BinaryReader reader(buffer.drop_front(sizeof(summary_magic)));
+  if (reader.read_number() != summary_version) {
+    return createStringError(inconvertibleErrorCode(),
+                             "unsupported version of the summary format");
+  }
+
+  ModuleSummary summary;
+  summary.module_name = reader.read_string();
+  const uint64_t module_flags = reader.read_number();
+  summary.is_checked = module_flags & MODULE_CHECKED;
+  summary.no_any_tag = module_flags & MODULE_NO_ANY_TAG;
+  summary.no_any_source = module_flags & MODULE_NO_ANY_SOURCE;
+  summary.exact_length = module_flags & MODULE_EXACT_LENGTH;
+
+  summary.functions.resize(reader.read_size());
+  for (auto &function : summary.functions) {
+    function.name = reader.read_string();
+    function.is_local = reader.read_number();
+    function.properties.flags = reader.read_number();
+
+    function.messages.resize(reader.read_size());
+    for (auto &message : function.messages) {
+      message.mpi_function = reader.read_string();
+      const uint64_t flags = reader.read_number();
+      message.is_send = flags & MESSAGE_IS_SEND;
+      message.escapes_scope = flags & MESSAGE_ESCAPES_SCOPE;
+      message.has_local_conflict = flags & MESSAGE_LOCAL_CONFLICT;
+      message.comm = reader.read_string();
+      message.peer = reader.read_string();
+      message.tag = reader.read_string();
+      message.pending_calls = reader.read_strings();
+      message.pending_at_return = reader.read_strings();
+    }
+
+    function.syncs.resize(reader.read_size());
+    for (auto &sync : function.syncs) {
+      sync.mpi_function = reader.read_string();
+      sync.comm = reader.read_string();
+    }
+
+    function.callees = reader.read_strings();
+    function.unknown_callees = reader.read_strings();
+
+    function.external_calls.resize(reader.read_size());
+    for (auto &call : function.external_calls) {
+      call.callee = reader.read_string();
+      call.is_synced = reader.read_number();
+      call.synced_comms = reader.read_strings();
+    }
+  }
+
+  if (reader.has_failed() || !reader.at_end()) {
+    return createStringError(inconvertibleErrorCode(),
+                             "corrupted communication summary");
+  }
+  return summary;
+}
@@ -0,0 +1,38 @@
+/*
+  Copyright 2020 Tim Jammer
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+       http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.
+ */
+
+#ifndef MACH_SUMMARY_FILE_H_
+#define MACH_SUMMARY_FILE_H_
+
+#include "llvm/ADT/StringRef.h"
+#include "llvm/Support/Error.h"
+
+#include "communication_summary.h"
+
+// binary format of the communication summaries written with
+// -mach-summary-dir and combined by mach-link (encoded with the
+// BinaryWriter of binary_stream.h)
+// it does not depend on the IR, so that mach-link only needs LLVMSupport
+
+// file extension of the summaries
+extern const char *summary_file_extension;
+
+llvm::Error write_summary_file(const ModuleSummary &summary,
+                               llvm::StringRef path);
+
+llvm::Expected<ModuleSummary> read_summary(llvm::StringRef buffer);
+
+#endif /* MACH_SUMMARY_FILE_H_ */
@@ -4,12 +4,14 @@
 #OMPI_CXX=clang++ mpicxx -fopenmp -Xclang -load -Xclang build/experimentpass/libexperimentpass.so  $1
 
 # using mpich:
+# further arguments are passed to the compiler, e.g. -mllvm -mach-first-conflict
 if [ ${1: -2} == ".c" ]; then
-$MPICC -cc=clang -O2 -fopenmp -Xclang -load -Xclang build/mpi_assertion_checker/libmpi_assertion_checker.so  $1
+$MPICC -cc=clang -O2 -fopenmp -Xclang -load -Xclang build/mpi_assertion_checker/libmpi_assertion_checker.so  $1 "${@:2}"
 #$MPICC -cc=clang -O2 -fopenmp -Xclang -load -Xclang build/mpi_assertion_checker/libmpi_assertion_checker.so  -ftime-report $1
+#$MPICC -cc=clang -O2 -fopenmp -Xclang -load -Xclang build/mpi_assertion_checker/libmpi_assertion_checker.so  -ftime-trace $1
 #$MPICC -cc=clang -O2 -fopenmp $1
 elif [ ${1: -4} == ".cpp" ]; then
-$MPICXX -cxx=clang++ -O2  -fopenmp -Xclang -load -Xclang build/mpi_assertion_checker/libmpi_assertion_checker.so  $1
+$MPICXX -cxx=clang++ -O2  -fopenmp -Xclang -load -Xclang build/mpi_assertion_checker/libmpi_assertion_checker.so  $1 "${@:2}"
 else
 echo "Unknown file suffix, use this script with .c or .cpp files"
 fi
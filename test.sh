@@ -5,6 +5,12 @@
 #Setup
 VERBOSE=true
 TEST_FILE=tests/test_cases.txt
+# expected result and assertions as in TEST_FILE, followed by the files of the
+# program, their summaries are combined with mach-link
+LINK_TEST_FILE=tests/link_cases.txt
+# expected result, expected result after changing a callee (compiled with
+# -DCHANGED_CALLEE) and the file, analyzed with the same -mach-cache-dir
+CACHE_TEST_FILE=tests/cache_cases.txt
 
 
 # colorize
@@ -13,22 +19,81 @@ Green='\033[0;32m'
 Yellow='\033[0;33m' 
 NC='\033[0m'
 
+# further arguments are passed to the compiler
 run_test () {
 test_name=$1
 expected_result=$2
 
 any_tag=$3
 any_source=$4
+exact_length=$5
+
+output=$(./run.sh $test_name "${@:6}" 2>&1)
+
+check_output "Successfully executed the pass"
+}
+
+# writes the summaries of all files of the program and combines them
+run_link_test () {
+expected_result=$1
+
+any_tag=$2
+any_source=$3
 exact_length=$4
 
+summary_dir=$(mktemp -d)
+for file in "${@:5}"; do
+	./run.sh $file -c -o /dev/null -mllvm -mach-summary-dir=$summary_dir > /dev/null 2>&1
+done
+output=$(build/mach_link/mach-link $summary_dir 2>&1)
+rm -rf $summary_dir
+
+check_output "Combined the summaries of"
+}
+
+# the second run reuses the cache written by the first one and needs to give
+# the same verdict, the changed callee needs to be analyzed again
+run_cache_test () {
+test_name=$3
+
+# the assertions are not checked
+any_tag=""
+any_source=""
+exact_length=""
+
+cache_dir=$(mktemp -d)
+for run in first second changed; do
+	expected_result=$1
+	flags=""
+	if [ "$run" == "changed" ]; then
+		expected_result=$2
+		flags="-DCHANGED_CALLEE"
+	fi
+	output=$(./run.sh $test_name $flags -mllvm -mach-cache-dir=$cache_dir 2>&1)
+	check_output "Successfully executed the pass"
+	result=$?
+	if [ "$run" == "first" -a "$(ls $cache_dir)" == "" ]; then
+		# nothing was cached
+		result=0
+	fi
+	if [ "$result" != 1 ]; then
+		break
+	fi
+done
+rm -rf $cache_dir
+
+return $result
+}
+
+# checks the output against expected_result and the assertions
+# $1: printed if the analysis was executed
+check_output () {
 # 0 means test failed!
 # 1 means test succeded!
 # 2 means crashed!
 exitcode=0
 
-output=$(./run.sh $test_name 2>&1)
-
-if [ "$( echo $output | grep "Successfully executed the pass")" == "" ]; then
+if [ "$( echo $output | grep "$1")" == "" ]; then
 	exitcode=2
 	# failed executing this code
 elif [ "$expected_result" == "no" ]; then
@@ -43,47 +108,73 @@ elif [ "$expected_result" == "conflict" ]; then
 	else
 		exitcode=1
 	fi
+elif [ "$expected_result" == "summary" ]; then
+	# library mode: a summary instead of a verdict
+	if [ "$( echo $output | grep "Communication summary of")" == "" -o "$( echo $output | grep "conflicts detected")" != "" ]; then
+		exitcode=0
+	else
+		exitcode=1
+	fi
+	# each line of the .summary file next to the test needs to be printed
+	expected_summary=${test_name%.*}.summary
+	if [ -f $expected_summary ]; then
+		while read summary_line; do
+			if [ "$( echo "$output" | grep -F -- "$summary_line")" == "" ]; then
+				exitcode=0
+				if [ "$VERBOSE" == true ]; then
+					echo -e "${Red}Missing${NC} $summary_line"
+				fi
+			fi
+		done < $expected_summary
+	fi
+fi
+
+if [ "$exitcode" == 2 ]; then
+	return $exitcode
 fi
 
 #NO_any_tag NO_any_source exact_length
 # if one of the othere assertion failes: test fails
 
 if [ "$any_tag" == "any_tag" -a "$( echo $output | grep "You can also safely specify mpi_assert_no_any_tag")" != "" ]; then
-	exitcode=1
+	exitcode=0
 	if [ "$VERBOSE" == true ]; then
 		echo -e "${Red}Wrongly${NC} assert_no_any_tag"
 	fi
 fi
 
 if [ "$any_tag" == "NO_any_tag" -a "$( echo $output | grep "You can also safely specify mpi_assert_no_any_tag")" == "" ]; then
+	exitcode=0
 	if [ "$VERBOSE" == true ]; then
-		echo -e "${Yellow}Missing${NC} assert_no_any_tag"
+		echo -e "${Red}Missing${NC} assert_no_any_tag"
 	fi
 fi
 
 if [ "$any_source" == "any_source" -a "$( echo $output | grep "You can also safely specify mpi_assert_no_any_source")" != "" ]; then
-	exitcode=1
+	exitcode=0
 	if [ "$VERBOSE" == true ]; then
 		echo -e "${Red}Wrongly${NC} assert_no_any_source"
 	fi
 fi
 
 if [ "$any_source" == "NO_any_source" -a "$( echo $output | grep "You can also safely specify mpi_assert_no_any_source")" == "" ]; then
+	exitcode=0
 	if [ "$VERBOSE" == true ]; then
-		echo -e "${Yellow}Missing${NC} assert_no_any_source"
+		echo -e "${Red}Missing${NC} assert_no_any_source"
 	fi
 fi
 
 if [ "$exact_length" == "NO_exact_length" -a "$( echo $output | grep "You can also safely specify mpi_assert_exact_length")" != "" ]; then
-	exitcode=1
+	exitcode=0
 	if [ "$VERBOSE" == true ]; then
 		echo -e "${Red}Wrongly${NC} assert_exact_length"
 	fi
 fi
 
 if [ "$exact_length" == "exact_length" -a "$( echo $output | grep "You can also safely specify mpi_assert_exact_length")" == "" ]; then
+	exitcode=0
 	if [ "$VERBOSE" == true ]; then
-		echo -e "${Yellow}Missing${NC} assert_exact_length"
+		echo -e "${Red}Missing${NC} assert_exact_length"
 	fi
 fi
 
@@ -94,14 +185,17 @@ return $exitcode
 num_tests=0
 succesful=0
 false_positive=0
+
+# $1: the function running each test case, $2: the file of test cases
+run_test_cases () {
 while read -u 6 line; do
 
-run_test $line
+$1 $line
 status=$?
 
 if [ "$status" == 2 ]; then
 	echo -e "${Red}CRASHED${NC}" $line
-elif [ "$status" == 0 ] && [ "$expected_result" == "conflict" ]; then
+elif [ "$status" == 0 ] && [ "$expected_result" != "no" ]; then
 	echo -e "${Red}FAILED${NC}" $line
 elif [ "$status" == 0 ] && [ "$expected_result" == "no" ]; then
 	echo -e "${Yellow}FALSE POSITIVE${NC}" $line
@@ -113,8 +207,13 @@ fi
 
 num_tests=$(( num_tests + 1 ))
 
-done 6<$TEST_FILE
+done 6<$2
 # not use stdin rather use input channel 6
+}
+
+run_test_cases run_test $TEST_FILE
+run_test_cases run_link_test $LINK_TEST_FILE
+run_test_cases run_cache_test $CACHE_TEST_FILE
 
 echo "succeded at $succesful (+${false_positive}) of $num_tests tests"
 
@@ -0,0 +1,33 @@
+#include <mpi.h>
+#include <stdio.h>
+
+#define MSG_TAG 123
+#define N 1000
+
+// run with 2 processes
+
+__attribute__((noinline)) void transfer(int *buf, int rank) {
+  if (rank == 1) {
+    MPI_Send(buf, 1, MPI_INT, 0, MSG_TAG, MPI_COMM_WORLD);
+  } else {
+    MPI_Recv(buf, 1, MPI_INT, 1, MSG_TAG, MPI_COMM_WORLD, MPI_STATUS_IGNORE);
+  }
+#ifdef CHANGED_CALLEE
+  // No conflict. the barrier separates the messages of both calls
+  MPI_Barrier(MPI_COMM_WORLD);
+#endif
+}
+
+// conflict: the message of the first call may be overtaken by the second one
+
+int main() {
+  int a = 1;
+  int b = 2;
+
+  MPI_Init(NULL, NULL);
+  int rank;
+  MPI_Comm_rank(MPI_COMM_WORLD, &rank);
+  transfer(&a, rank);
+  transfer(&b, rank);
+  MPI_Finalize();
+}
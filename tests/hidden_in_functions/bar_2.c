@@ -0,0 +1,33 @@
+#include <mpi.h>
+#include <stdio.h>
+
+#define MSG_TAG 123
+#define N 1000
+
+__attribute__((noinline)) void call_barrier() { MPI_Barrier(MPI_COMM_WORLD); }
+
+__attribute__((noinline)) void sync_all() { call_barrier(); }
+
+// barrier hidden in two layers of function calls seperates the msg
+
+int main() {
+  int a = 1;
+  int b = 2;
+
+  MPI_Init(NULL, NULL);
+  int rank;
+  MPI_Comm_rank(MPI_COMM_WORLD, &rank);
+  switch (rank) {
+  case 0:
+    MPI_Recv(&a, 1, MPI_INT, 1, MSG_TAG, MPI_COMM_WORLD, MPI_STATUS_IGNORE);
+    sync_all();
+    MPI_Recv(&b, 1, MPI_INT, 1, MSG_TAG, MPI_COMM_WORLD, MPI_STATUS_IGNORE);
+    break;
+  case 1:
+    MPI_Send(&a, 1, MPI_INT, 0, MSG_TAG, MPI_COMM_WORLD);
+    sync_all();
+    MPI_Send(&b, 1, MPI_INT, 0, MSG_TAG, MPI_COMM_WORLD);
+    break;
+  }
+  MPI_Finalize();
+}
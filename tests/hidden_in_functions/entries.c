@@ -0,0 +1,44 @@
+#include <mpi.h>
+#include <stdio.h>
+
+#define MSG_TAG 123
+#define N 1000
+
+__attribute__((noinline)) int compute(int x) {
+  int sum = 0;
+  for (int i = 0; i < N; ++i) {
+    sum += x * i;
+  }
+  return sum;
+}
+
+__attribute__((noinline)) void call_barrier() { MPI_Barrier(MPI_COMM_WORLD); }
+
+// No conflict. the traversal continues after the call of compute, which does
+// not communicate, until the barrier within call_barrier
+
+int main() {
+  int a = 1;
+  int b = 2;
+
+  MPI_Init(NULL, NULL);
+  int rank;
+  MPI_Comm_rank(MPI_COMM_WORLD, &rank);
+  switch (rank) {
+  case 0:
+    MPI_Recv(&a, 1, MPI_INT, 1, MSG_TAG, MPI_COMM_WORLD, MPI_STATUS_IGNORE);
+    MPI_Barrier(MPI_COMM_WORLD);
+    MPI_Recv(&b, 1, MPI_INT, 1, MSG_TAG, MPI_COMM_WORLD, MPI_STATUS_IGNORE);
+    break;
+  case 1:
+    MPI_Send(&a, 1, MPI_INT, 0, MSG_TAG, MPI_COMM_WORLD);
+    b = compute(a);
+    call_barrier();
+    MPI_Send(&b, 1, MPI_INT, 0, MSG_TAG, MPI_COMM_WORLD);
+    break;
+  default:
+    MPI_Barrier(MPI_COMM_WORLD);
+    break;
+  }
+  MPI_Finalize();
+}
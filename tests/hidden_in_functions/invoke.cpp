@@ -0,0 +1,41 @@
+#include <mpi.h>
+#include <stdexcept>
+
+#define MSG_TAG 123
+#define N 1000
+
+// the send is hidden in a function that may throw, so it is invoked
+
+__attribute__((noinline)) void checked_send(int *buf, int rank) {
+  if (rank < 0) {
+    throw std::invalid_argument("invalid rank");
+  }
+  MPI_Send(buf, 1, MPI_INT, 0, MSG_TAG, MPI_COMM_WORLD);
+}
+
+// conflict: returning from checked_send, the message may be overtaken by the
+// next one
+
+int main() {
+  int a = 1;
+  int b = 2;
+
+  MPI_Init(NULL, NULL);
+  int rank;
+  MPI_Comm_rank(MPI_COMM_WORLD, &rank);
+  switch (rank) {
+  case 0:
+    MPI_Recv(&a, 1, MPI_INT, 1, MSG_TAG, MPI_COMM_WORLD, MPI_STATUS_IGNORE);
+    MPI_Recv(&b, 1, MPI_INT, 1, MSG_TAG, MPI_COMM_WORLD, MPI_STATUS_IGNORE);
+    break;
+  case 1:
+    try {
+      checked_send(&a, rank);
+    } catch (const std::exception &e) {
+      MPI_Abort(MPI_COMM_WORLD, 1);
+    }
+    MPI_Send(&b, 1, MPI_INT, 0, MSG_TAG, MPI_COMM_WORLD);
+    break;
+  }
+  MPI_Finalize();
+}
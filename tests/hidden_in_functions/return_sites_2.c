@@ -0,0 +1,37 @@
+#include <mpi.h>
+#include <stdio.h>
+
+#define MSG_TAG 123
+#define N 1000
+
+__attribute__((noinline)) void send(int *buf) {
+  MPI_Send(buf, 1, MPI_INT, 0, MSG_TAG, MPI_COMM_WORLD);
+}
+
+// conflict: returning from the second call of send, the message may be
+// overtaken by the last one
+
+int main() {
+  int a = 1;
+  int b = 2;
+  int c = 3;
+
+  MPI_Init(NULL, NULL);
+  int rank;
+  MPI_Comm_rank(MPI_COMM_WORLD, &rank);
+  switch (rank) {
+  case 0:
+    MPI_Recv(&a, 1, MPI_INT, 1, MSG_TAG, MPI_COMM_WORLD, MPI_STATUS_IGNORE);
+    MPI_Barrier(MPI_COMM_WORLD);
+    MPI_Recv(&b, 1, MPI_INT, 1, MSG_TAG, MPI_COMM_WORLD, MPI_STATUS_IGNORE);
+    MPI_Recv(&c, 1, MPI_INT, 1, MSG_TAG, MPI_COMM_WORLD, MPI_STATUS_IGNORE);
+    break;
+  case 1:
+    send(&a);
+    MPI_Barrier(MPI_COMM_WORLD);
+    send(&b);
+    MPI_Send(&c, 1, MPI_INT, 0, MSG_TAG, MPI_COMM_WORLD);
+    break;
+  }
+  MPI_Finalize();
+}
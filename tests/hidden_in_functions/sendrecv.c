@@ -0,0 +1,30 @@
+#include <mpi.h>
+#include <stdio.h>
+
+#define MSG_TAG 123
+#define N 1000
+
+__attribute__((noinline)) void exchange(int *send_buf, int *recv_buf,
+                                        int partner) {
+  MPI_Sendrecv(send_buf, 1, MPI_INT, partner, MSG_TAG, recv_buf, 1, MPI_INT,
+               partner, MSG_TAG, MPI_COMM_WORLD, MPI_STATUS_IGNORE);
+}
+
+// No conflict. the barrier separates both exchanges
+
+int main() {
+  int a = 1;
+  int b = 2;
+
+  MPI_Init(NULL, NULL);
+  int rank;
+  MPI_Comm_rank(MPI_COMM_WORLD, &rank);
+  if (rank < 2) {
+    exchange(&a, &b, 1 - rank);
+    MPI_Barrier(MPI_COMM_WORLD);
+    exchange(&b, &a, 1 - rank);
+  } else {
+    MPI_Barrier(MPI_COMM_WORLD);
+  }
+  MPI_Finalize();
+}
@@ -0,0 +1,18 @@
+#include <mpi.h>
+#include <stdio.h>
+
+#define MSG_TAG 123
+#define N 1000
+
+// part of a library, MPI is initialized by the application
+// instead of a verdict, the communication of each function is summarized
+
+void send_data(int *buf, int dest) {
+  MPI_Send(buf, 1, MPI_INT, dest, MSG_TAG, MPI_COMM_WORLD);
+}
+
+void start_send(int *buf, MPI_Request *req) {
+  MPI_Isend(buf, 1, MPI_INT, 0, MSG_TAG, MPI_COMM_WORLD, req);
+}
+
+void sync_all() { MPI_Barrier(MPI_COMM_WORLD); }
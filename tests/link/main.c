@@ -0,0 +1,35 @@
+#include <mpi.h>
+#include <stdio.h>
+
+#define MSG_TAG 123
+#define N 1000
+
+// defined in another module
+void send_data(int *buf);
+void recv_data(int *buf);
+
+// the nonblocking message is pending while the functions of the other module
+// communicate, so the verdict depends on their summary
+
+int main() {
+  int a = 1;
+  int b = 2;
+  MPI_Request req;
+
+  MPI_Init(NULL, NULL);
+  int rank;
+  MPI_Comm_rank(MPI_COMM_WORLD, &rank);
+  switch (rank) {
+  case 0:
+    MPI_Irecv(&a, 1, MPI_INT, 1, MSG_TAG, MPI_COMM_WORLD, &req);
+    recv_data(&b);
+    MPI_Wait(&req, MPI_STATUS_IGNORE);
+    break;
+  case 1:
+    MPI_Isend(&a, 1, MPI_INT, 0, MSG_TAG, MPI_COMM_WORLD, &req);
+    send_data(&b);
+    MPI_Wait(&req, MPI_STATUS_IGNORE);
+    break;
+  }
+  MPI_Finalize();
+}
@@ -0,0 +1,15 @@
+#include <mpi.h>
+#include <stdio.h>
+
+#define MSG_TAG 123
+#define N 1000
+
+// conflict with main.c: same tag as the pending message
+
+void send_data(int *buf) {
+  MPI_Send(buf, 1, MPI_INT, 0, MSG_TAG, MPI_COMM_WORLD);
+}
+
+void recv_data(int *buf) {
+  MPI_Recv(buf, 1, MPI_INT, 1, MSG_TAG, MPI_COMM_WORLD, MPI_STATUS_IGNORE);
+}
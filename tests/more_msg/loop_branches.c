@@ -0,0 +1,42 @@
+#include <mpi.h>
+#include <stdio.h>
+
+#define MSG_TAG 123
+#define N 1000
+
+// No conflict. only one of the branches is taken in each iteration, a message
+// of one branch only reaches the other branch in the next iteration, which
+// uses another tag
+
+int main() {
+  int a = 1;
+  int b = 2;
+
+  MPI_Request req;
+
+  MPI_Init(NULL, NULL);
+  int rank;
+  MPI_Comm_rank(MPI_COMM_WORLD, &rank);
+  switch (rank) {
+  case 0:
+    for (int i = 0; i < N; ++i) {
+      if (i % 2 == 0) {
+        MPI_Recv(&a, 1, MPI_INT, 1, i, MPI_COMM_WORLD, MPI_STATUS_IGNORE);
+      } else {
+        MPI_Recv(&b, 1, MPI_INT, 1, i, MPI_COMM_WORLD, MPI_STATUS_IGNORE);
+      }
+    }
+    break;
+  case 1:
+    for (int i = 0; i < N; ++i) {
+      if (i % 2 == 0) {
+        MPI_Send(&a, 1, MPI_INT, 0, i, MPI_COMM_WORLD);
+      } else {
+        MPI_Isend(&b, 1, MPI_INT, 0, i, MPI_COMM_WORLD, &req);
+        MPI_Wait(&req, MPI_STATUS_IGNORE);
+      }
+    }
+    break;
+  }
+  MPI_Finalize();
+}
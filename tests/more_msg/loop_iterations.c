@@ -0,0 +1,44 @@
+#include <mpi.h>
+#include <stdio.h>
+
+#define MSG_TAG 123
+#define N 1000
+
+// No conflict. the barrier ends the first message before the second one is
+// sent, the second message only reaches the first send in the next
+// iteration, which uses another tag
+
+int main() {
+  int a = 1;
+  int b = 2;
+
+  MPI_Init(NULL, NULL);
+  int rank;
+  MPI_Comm_rank(MPI_COMM_WORLD, &rank);
+  switch (rank) {
+  case 0:
+    for (int i = 0; i < N; ++i) {
+      MPI_Recv(&a, 1, MPI_INT, 1, i, MPI_COMM_WORLD, MPI_STATUS_IGNORE);
+      MPI_Barrier(MPI_COMM_WORLD);
+      if (i % 2 == 0) {
+        MPI_Recv(&b, 1, MPI_INT, 1, i, MPI_COMM_WORLD, MPI_STATUS_IGNORE);
+      }
+    }
+    break;
+  case 1:
+    for (int i = 0; i < N; ++i) {
+      MPI_Send(&a, 1, MPI_INT, 0, i, MPI_COMM_WORLD);
+      MPI_Barrier(MPI_COMM_WORLD);
+      if (i % 2 == 0) {
+        MPI_Send(&b, 1, MPI_INT, 0, i, MPI_COMM_WORLD);
+      }
+    }
+    break;
+  default:
+    for (int i = 0; i < N; ++i) {
+      MPI_Barrier(MPI_COMM_WORLD);
+    }
+    break;
+  }
+  MPI_Finalize();
+}
@@ -0,0 +1,46 @@
+#include <mpi.h>
+#include <stdio.h>
+
+#define MSG_TAG 123
+#define N 2
+
+// conflict: the Waitall only completes the first request, the second message
+// may be overtaken by the one after the barrier
+
+int main() {
+  int buf[N];
+  int c = 3;
+
+  MPI_Request req[N];
+
+  MPI_Init(NULL, NULL);
+  int rank;
+  MPI_Comm_rank(MPI_COMM_WORLD, &rank);
+
+  switch (rank) {
+  case 0:
+    for (int i = 0; i < N; ++i) {
+      MPI_Recv(&buf[i], 1, MPI_INT, 1, MSG_TAG + i, MPI_COMM_WORLD,
+               MPI_STATUS_IGNORE);
+    }
+    MPI_Barrier(MPI_COMM_WORLD);
+    MPI_Recv(&c, 1, MPI_INT, 1, MSG_TAG + 1, MPI_COMM_WORLD,
+             MPI_STATUS_IGNORE);
+    break;
+  case 1:
+    for (int i = 0; i < N; ++i) {
+      buf[i] = i;
+      MPI_Isend(&buf[i], 1, MPI_INT, 0, MSG_TAG + i, MPI_COMM_WORLD, &req[i]);
+    }
+    MPI_Waitall(1, req, MPI_STATUSES_IGNORE);
+    MPI_Barrier(MPI_COMM_WORLD);
+    MPI_Isend(&c, 1, MPI_INT, 0, MSG_TAG + 1, MPI_COMM_WORLD, &req[0]);
+    MPI_Wait(&req[0], MPI_STATUS_IGNORE);
+    MPI_Wait(&req[1], MPI_STATUS_IGNORE);
+    break;
+  default:
+    MPI_Barrier(MPI_COMM_WORLD);
+    break;
+  }
+  MPI_Finalize();
+}
@@ -0,0 +1,42 @@
+#include <mpi.h>
+#include <stdio.h>
+
+#define MSG_TAG 123
+#define N 2
+
+// No conflict. the Waitall completes both request slots before the barrier
+
+int main() {
+  int a = 1;
+  int b = 2;
+  int c = 3;
+
+  MPI_Request req[N];
+
+  MPI_Init(NULL, NULL);
+  int rank;
+  MPI_Comm_rank(MPI_COMM_WORLD, &rank);
+
+  switch (rank) {
+  case 0:
+    MPI_Recv(&a, 1, MPI_INT, 1, MSG_TAG, MPI_COMM_WORLD, MPI_STATUS_IGNORE);
+    MPI_Recv(&b, 1, MPI_INT, 1, MSG_TAG + 1, MPI_COMM_WORLD,
+             MPI_STATUS_IGNORE);
+    MPI_Barrier(MPI_COMM_WORLD);
+    MPI_Recv(&c, 1, MPI_INT, 1, MSG_TAG + 1, MPI_COMM_WORLD,
+             MPI_STATUS_IGNORE);
+    break;
+  case 1:
+    MPI_Isend(&a, 1, MPI_INT, 0, MSG_TAG, MPI_COMM_WORLD, &req[0]);
+    MPI_Isend(&b, 1, MPI_INT, 0, MSG_TAG + 1, MPI_COMM_WORLD, &req[1]);
+    MPI_Waitall(N, req, MPI_STATUSES_IGNORE);
+    MPI_Barrier(MPI_COMM_WORLD);
+    MPI_Isend(&c, 1, MPI_INT, 0, MSG_TAG + 1, MPI_COMM_WORLD, &req[0]);
+    MPI_Wait(&req[0], MPI_STATUS_IGNORE);
+    break;
+  default:
+    MPI_Barrier(MPI_COMM_WORLD);
+    break;
+  }
+  MPI_Finalize();
+}
@@ -0,0 +1,31 @@
+#include <mpi.h>
+#include <stdio.h>
+
+#define MSG_TAG 123
+#define N 1000
+
+// No conflict. both sends are guarded by the same condition, only one of them
+// is executed by a process
+
+int main() {
+  int a = 1;
+  int b = 2;
+
+  MPI_Init(NULL, NULL);
+  int rank;
+  MPI_Comm_rank(MPI_COMM_WORLD, &rank);
+  if (rank == 0) {
+    MPI_Recv(&a, 1, MPI_INT, 1, MSG_TAG, MPI_COMM_WORLD, MPI_STATUS_IGNORE);
+    MPI_Recv(&b, 1, MPI_INT, 2, MSG_TAG, MPI_COMM_WORLD, MPI_STATUS_IGNORE);
+  } else {
+    int is_first = rank == 1;
+    if (is_first) {
+      MPI_Send(&a, 1, MPI_INT, 0, MSG_TAG, MPI_COMM_WORLD);
+    }
+    printf("Rank %d passed the first message\n", rank);
+    if (!is_first) {
+      MPI_Send(&b, 1, MPI_INT, 0, MSG_TAG, MPI_COMM_WORLD);
+    }
+  }
+  MPI_Finalize();
+}
@@ -0,0 +1,41 @@
+#include <mpi.h>
+#include <stdio.h>
+
+#define MSG_TAG_A 123
+#define MSG_TAG_B 1234
+#define N 1000
+
+// Conflict. the code after the second send is reached by both messages: the
+// barrier ends the second one, but not the first one, whose scope only ends
+// at the wait
+
+int main() {
+  int a = 1;
+  int b = 2;
+  int c = 3;
+
+  MPI_Request req;
+
+  MPI_Init(NULL, NULL);
+  int rank;
+  MPI_Comm_rank(MPI_COMM_WORLD, &rank);
+  switch (rank) {
+  case 0:
+    MPI_Recv(&b, 1, MPI_INT, 1, MSG_TAG_B, MPI_COMM_WORLD, MPI_STATUS_IGNORE);
+    MPI_Barrier(MPI_COMM_WORLD);
+    MPI_Recv(&a, 1, MPI_INT, 1, MSG_TAG_A, MPI_COMM_WORLD, MPI_STATUS_IGNORE);
+    MPI_Recv(&c, 1, MPI_INT, 1, MSG_TAG_A, MPI_COMM_WORLD, MPI_STATUS_IGNORE);
+    break;
+  case 1:
+    MPI_Isend(&a, 1, MPI_INT, 0, MSG_TAG_A, MPI_COMM_WORLD, &req);
+    MPI_Send(&b, 1, MPI_INT, 0, MSG_TAG_B, MPI_COMM_WORLD);
+    MPI_Barrier(MPI_COMM_WORLD);
+    MPI_Wait(&req, MPI_STATUS_IGNORE);
+    MPI_Send(&c, 1, MPI_INT, 0, MSG_TAG_A, MPI_COMM_WORLD);
+    break;
+  default:
+    MPI_Barrier(MPI_COMM_WORLD);
+    break;
+  }
+  MPI_Finalize();
+}
@@ -0,0 +1,39 @@
+#include <mpi.h>
+#include <stdio.h>
+
+#define MSG_TAG 123
+#define N 1000
+
+__attribute__((noinline)) int get_tag(int rank) { return MSG_TAG + rank; }
+
+// No conflict. the tags are only known relative to each other, the comparison
+// of the partner (the same value for all messages) is reused for every pair
+
+int main() {
+  int a = 1;
+  int b = 2;
+  int c = 3;
+
+  MPI_Init(NULL, NULL);
+  int rank;
+  int size;
+  MPI_Comm_rank(MPI_COMM_WORLD, &rank);
+  MPI_Comm_size(MPI_COMM_WORLD, &size);
+
+  int next = (rank + 1) % size;
+  int prev = (rank + size - 1) % size;
+  int tag = get_tag(rank);
+  int prev_tag = get_tag(prev);
+
+  MPI_Request req[3];
+  MPI_Irecv(&a, 1, MPI_INT, prev, prev_tag, MPI_COMM_WORLD, &req[0]);
+  MPI_Irecv(&b, 1, MPI_INT, prev, prev_tag + 1, MPI_COMM_WORLD, &req[1]);
+  MPI_Irecv(&c, 1, MPI_INT, prev, prev_tag + 2, MPI_COMM_WORLD, &req[2]);
+
+  MPI_Send(&rank, 1, MPI_INT, next, tag, MPI_COMM_WORLD);
+  MPI_Send(&rank, 1, MPI_INT, next, tag + 1, MPI_COMM_WORLD);
+  MPI_Send(&rank, 1, MPI_INT, next, tag + 2, MPI_COMM_WORLD);
+
+  MPI_Waitall(3, req, MPI_STATUSES_IGNORE);
+  MPI_Finalize();
+}